@@ -0,0 +1,106 @@
+// Microbenchmark: previous two-row DP Levenshtein vs editdist (bit-parallel,
+// unbounded and bounded) on the shipped city list and a synthetic 1M-name set.
+// Usage: bench_levenshtein [path/to/cities.csv]
+#include "editdist.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// The implementation ui.cpp used before editdist
+static int lev_dp(std::string_view a, std::string_view b){
+    size_t n=a.size(), m=b.size();
+    if (n==0) return (int)m;
+    if (m==0) return (int)n;
+    std::vector<int> prev(m+1), curr(m+1);
+    for(size_t j=0;j<=m;++j) prev[j] = (int)j;
+    for(size_t i=1;i<=n;++i){
+        curr[0] = (int)i;
+        for(size_t j=1;j<=m;++j){
+            int cost = (a[i-1]==b[j-1])?0:1;
+            curr[j] = std::min({ prev[j] + 1, curr[j-1] + 1, prev[j-1] + cost });
+        }
+        std::swap(prev, curr);
+    }
+    return prev[m];
+}
+
+static std::string lower(std::string s){
+    for (auto& ch : s) ch = (char)std::tolower((unsigned char)ch);
+    return s;
+}
+
+// "name, country" lowercased, like the normalized index entries
+static std::vector<std::string> load_names(const std::string& path){
+    std::vector<std::string> out;
+    std::ifstream in(path);
+    std::string line;
+    bool header = true;
+    while (std::getline(in, line)){
+        if (header){ header = false; continue; }
+        if (line.empty() || line[0] == '#') continue;
+        size_t c1 = line.find(','); if (c1 == std::string::npos) continue;
+        size_t c2 = line.find(',', c1 + 1); if (c2 == std::string::npos) continue;
+        out.push_back(lower(line.substr(0, c1) + ", " + line.substr(c1 + 1, c2 - c1 - 1)));
+    }
+    return out;
+}
+
+static std::vector<std::string> synthetic_names(size_t n){
+    std::mt19937 rng(42);
+    std::vector<std::string> out; out.reserve(n);
+    const char* countries[] = {"saudi arabia", "egypt", "indonesia", "pakistan", "turkey", "morocco", "united kingdom", "malaysia"};
+    for (size_t i=0;i<n;++i){
+        std::string s;
+        size_t len = 4 + rng() % 14;
+        for (size_t j=0;j<len;++j) s.push_back((char)('a' + rng() % 26));
+        s += ", ";
+        s += countries[rng() % 8];
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+template <class F>
+static void run(const char* label, const std::vector<std::string>& names, const std::vector<std::string>& queries, F dist){
+    auto t0 = std::chrono::steady_clock::now();
+    long long checksum = 0;
+    for (const auto& q : queries){
+        int best = 1 << 30;
+        for (const auto& n : names){
+            int d = dist(n, q, best);
+            if (d < best) best = d;
+        }
+        checksum += best;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    double pairs = (double)names.size() * (double)queries.size();
+    std::printf("  %-22s %9.2f ms  %7.1f ns/pair  (best-sum %lld)\n", label, sec * 1e3, sec * 1e9 / pairs, checksum);
+}
+
+static void bench(const char* title, const std::vector<std::string>& names, const std::vector<std::string>& queries){
+    std::printf("%s: %zu names x %zu queries\n", title, names.size(), queries.size());
+    run("dp (previous)", names, queries, [](const std::string& a, const std::string& b, int){ return lev_dp(a, b); });
+    run("bit-parallel", names, queries, [](const std::string& a, const std::string& b, int){ return editdist::levenshtein(a, b); });
+    run("bit-parallel bounded", names, queries, [](const std::string& a, const std::string& b, int best){
+        return editdist::levenshtein_bounded(a, b, best - 1);
+    });
+}
+
+int main(int argc, char** argv){
+    std::string csv = argc > 1 ? argv[1] : "data/cities.csv";
+    std::vector<std::string> queries = {"riyad", "makka", "jedda, saudi", "kairo", "istanbol", "kuala lumpor", "londn", "new yrok"};
+
+    std::vector<std::string> cities = load_names(csv);
+    if (cities.empty()){ std::fprintf(stderr, "no cities in %s\n", csv.c_str()); return 1; }
+    std::vector<std::string> many;
+    for (int r=0;r<200;++r) many.insert(many.end(), queries.begin(), queries.end());
+    bench("cities.csv", cities, many);
+
+    bench("synthetic", synthetic_names(1000000), queries);
+    return 0;
+}
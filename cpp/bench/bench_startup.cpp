@@ -0,0 +1,92 @@
+// Startup benchmark: wall time of complete `al-muslim --once` runs (spawn to
+// exit), the path status bars and cron jobs take every few seconds. Uses a
+// throwaway config and cache directory with a fixed location so that results
+// do not depend on (or touch) the machine's own setup. Times the cached run
+// and a --no-cache run; exits non-zero when either median is over budget.
+// Usage: bench_startup <path/to/al-muslim> [runs=200] [budget-ms=1.0] [-- extra args]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// Median wall time of `runs` spawns of args, after three warm-up runs that fill
+// the page cache (and today.bin); counts runs exiting non-zero in `failed`
+static double time_runs(const std::vector<std::string>& args, int runs, double budgetMs, int& failed){
+    std::vector<std::string> copy = args;
+    std::vector<char*> cargv;
+    for (auto& a : copy) cargv.push_back(a.data());
+    cargv.push_back(nullptr);
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::vector<double> ms;
+    ms.reserve(runs);
+    for (int i = -3; i < runs; ++i){
+        auto t0 = std::chrono::steady_clock::now();
+        pid_t pid;
+        if (posix_spawn(&pid, cargv[0], &fa, nullptr, cargv.data(), environ) != 0){ std::perror("posix_spawn"); std::exit(2); }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        auto t1 = std::chrono::steady_clock::now();
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+        if (i >= 0) ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    posix_spawn_file_actions_destroy(&fa);
+
+    std::sort(ms.begin(), ms.end());
+    double median = ms[ms.size() / 2];
+    std::printf("%d runs of", runs);
+    for (auto& a : args) std::printf(" %s", a.c_str());
+    std::printf("\nmin %.3f ms  median %.3f ms  p95 %.3f ms  max %.3f ms  (budget %.3f ms)\n",
+                ms.front(), median, ms[ms.size() * 95 / 100], ms.back(), budgetMs);
+    return median;
+}
+
+int main(int argc, char** argv){
+    if (argc < 2){
+        std::fprintf(stderr, "Usage: bench_startup <path/to/al-muslim> [runs=200] [budget-ms=1.0] [-- extra args]\n");
+        return 2;
+    }
+    const char* exe = argv[1];
+    int runs = argc > 2 && std::string(argv[2]) != "--" ? std::max(1, std::atoi(argv[2])) : 200;
+    double budgetMs = argc > 3 && std::string(argv[3]) != "--" ? std::atof(argv[3]) : 1.0;
+    std::vector<std::string> args = {exe, "--once"};
+    for (int i = 2; i < argc; ++i){
+        if (std::string(argv[i]) != "--") continue;
+        args.assign({exe});
+        for (int k = i + 1; k < argc; ++k) args.push_back(argv[k]);
+        break;
+    }
+
+    char dir[] = "/tmp/almuslim-bench-XXXXXX";
+    if (!mkdtemp(dir)){ std::perror("mkdtemp"); return 2; }
+    std::string config = std::string(dir) + "/config.toml";
+    std::ofstream(config) << "[location]\ncity = \"Makkah, Saudi Arabia\"\nlatitude = 21.4225\n"
+                             "longitude = 39.8262\ntimezone = \"+03:00\"\n";
+    setenv("ALMUSLIM_CONFIG", config.c_str(), 1);
+    // today.bin goes to <dir>/almuslim, never to the user's ~/.cache
+    setenv("XDG_CACHE_HOME", dir, 1);
+
+    int failed = 0;
+    double cached = time_runs(args, runs, budgetMs, failed);
+    std::vector<std::string> uncachedArgs = args;
+    uncachedArgs.push_back("--no-cache");
+    double uncached = time_runs(uncachedArgs, runs, budgetMs, failed);
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    if (failed) std::printf("%d runs exited with an error\n", failed);
+    return failed || cached > budgetMs || uncached > budgetMs ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+# Generate a C++ source holding copies of data files, for resources::embedded().
+# Usage: cmake -DDATA_DIR=<dir> -DOUT=<file.cpp> "-DFILES=a;b/c" [-DGEN_DIR=<dir> "-DGEN_FILES=x"] -P EmbedData.cmake
+# FILES are paths relative to DATA_DIR, GEN_FILES relative to GEN_DIR (files the
+# build produces, such as cities.idx); each becomes a NUL-terminated byte array,
+# 8-byte aligned so that binary images can be read in place.
+
+if (NOT DATA_DIR OR NOT OUT OR NOT FILES)
+  message(FATAL_ERROR "EmbedData.cmake needs DATA_DIR, OUT and FILES")
+endif()
+
+set(body "// Generated by cmake/EmbedData.cmake from ${DATA_DIR}; do not edit.\n#include \"resources.hpp\"\n\nnamespace resources {\n\n")
+set(table "")
+set(n 0)
+function(embed dir rel)
+  file(READ "${dir}/${rel}" hex HEX)
+  string(LENGTH "${hex}" hexLen)
+  math(EXPR size "${hexLen} / 2")
+  # 0xNN, per byte, 16 bytes per line
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+  string(REPEAT "0x[0-9a-f][0-9a-f]," 16 line16)
+  string(REGEX REPLACE "(${line16})" "\\1\n" bytes "${bytes}")
+  string(APPEND body "alignas(8) static const unsigned char kData${n}[] = {\n${bytes}0x00\n};\n\n")
+  string(APPEND table "    {\"${rel}\", kData${n}, ${size}},\n")
+  math(EXPR n "${n} + 1")
+  set(body "${body}" PARENT_SCOPE)
+  set(table "${table}" PARENT_SCOPE)
+  set(n ${n} PARENT_SCOPE)
+endfunction()
+foreach(rel IN LISTS FILES)
+  embed("${DATA_DIR}" "${rel}")
+endforeach()
+foreach(rel IN LISTS GEN_FILES)
+  embed("${GEN_DIR}" "${rel}")
+endforeach()
+string(APPEND body "const EmbeddedFile kEmbeddedFiles[] = {\n${table}};\nconst size_t kEmbeddedCount = ${n};\n\n} // namespace resources\n")
+
+# Only touch the output when it changes, so unchanged data does not trigger a rebuild
+if (EXISTS "${OUT}")
+  file(READ "${OUT}" old)
+  if (old STREQUAL body)
+    return()
+  endif()
+endif()
+file(WRITE "${OUT}" "${body}")
@@ -0,0 +1,201 @@
+#include "aliases.hpp"
+#include "textnorm.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+namespace fs = std::filesystem;
+
+namespace aliases {
+
+// Accessed only through std::atomic_load/atomic_store, as in hijri.cpp
+static std::shared_ptr<const Dictionary> g_current;
+
+static std::string trim(std::string_view s){
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string_view::npos) return std::string();
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return std::string(s.substr(a, b - a + 1));
+}
+
+static std::string fold_trimmed(std::string_view s){
+    std::string f = textnorm::fold(s);
+    return trim(f);
+}
+
+std::shared_ptr<const Dictionary> Dictionary::from_csv(const fs::path& csv){
+    std::ifstream in(csv, std::ios::binary);
+    if (!in) return nullptr;
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return from_text(text);
+}
+
+std::shared_ptr<const Dictionary> Dictionary::from_text(std::string_view text){
+    std::vector<Entry> entries;
+    if (text.size() >= 3 && (unsigned char)text[0]==0xEF && (unsigned char)text[1]==0xBB && (unsigned char)text[2]==0xBF) text.remove_prefix(3);
+    bool first = true;
+    while (!text.empty()){
+        size_t nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+        if (first){
+            first = false;
+            if (trim(line) == "alias,target") continue;
+        }
+        std::string t = trim(line);
+        if (t.empty() || t[0] == '#') continue;
+        size_t comma = t.find(',');
+        if (comma == std::string::npos) continue;
+        Entry e{fold_trimmed(std::string_view(t).substr(0, comma)), fold_trimmed(std::string_view(t).substr(comma + 1))};
+        if (e.alias.empty() || e.target.empty() || e.alias == e.target) continue;
+        entries.push_back(std::move(e));
+    }
+    return from_entries(std::move(entries));
+}
+
+std::shared_ptr<const Dictionary> Dictionary::from_entries(std::vector<Entry> entries){
+    auto d = std::make_shared<Dictionary>();
+    d->entries_ = std::move(entries);
+    d->build();
+    return d;
+}
+
+void Dictionary::build(){
+    // Pattern list: aliases first (first spelling wins on duplicates), then targets
+    std::map<std::string, uint32_t> index;
+    auto add = [&](const std::string& p){
+        auto it = index.find(p);
+        if (it != index.end()) return it->second;
+        uint32_t i = (uint32_t)patterns_.size();
+        index.emplace(p, i);
+        patterns_.push_back(p);
+        replacement_.push_back(i);
+        return i;
+    };
+    std::vector<std::pair<uint32_t, std::string>> pending;
+    for (const auto& e : entries_) pending.emplace_back(add(e.alias), e.target);
+    for (const auto& p : pending){
+        uint32_t target = add(p.second);
+        if (p.first != target && replacement_[p.first] == p.first) replacement_[p.first] = target;
+    }
+
+    // Trie with per-node sorted child maps, flattened below
+    std::vector<std::map<unsigned char, uint32_t>> kids(1);
+    std::vector<int32_t> match(1, -1);
+    for (uint32_t pi = 0; pi < patterns_.size(); ++pi){
+        uint32_t n = 0;
+        for (unsigned char c : patterns_[pi]){
+            auto it = kids[n].find(c);
+            if (it == kids[n].end()){
+                uint32_t m = (uint32_t)kids.size();
+                kids[n].emplace(c, m);
+                kids.emplace_back();
+                match.push_back(-1);
+                n = m;
+            } else n = it->second;
+        }
+        if (match[n] < 0) match[n] = (int32_t)pi;
+    }
+    const size_t nodes = kids.size();
+    edgeStart_.assign(nodes + 1, 0);
+    for (size_t n = 0; n < nodes; ++n) edgeStart_[n + 1] = edgeStart_[n] + (uint32_t)kids[n].size();
+    edgeByte_.resize(edgeStart_[nodes]);
+    edgeTo_.resize(edgeStart_[nodes]);
+    for (size_t n = 0; n < nodes; ++n){
+        uint32_t k = edgeStart_[n];
+        for (const auto& kv : kids[n]){ edgeByte_[k] = kv.first; edgeTo_[k] = kv.second; ++k; }
+    }
+    match_ = std::move(match);
+
+    // Failure and output links, breadth first
+    fail_.assign(nodes, 0);
+    outLink_.assign(nodes, 0);
+    std::vector<uint32_t> queue;
+    queue.reserve(nodes);
+    for (uint32_t k = edgeStart_[0]; k < edgeStart_[1]; ++k) queue.push_back(edgeTo_[k]);
+    for (size_t qi = 0; qi < queue.size(); ++qi){
+        uint32_t n = queue[qi];
+        for (uint32_t k = edgeStart_[n]; k < edgeStart_[n + 1]; ++k){
+            unsigned char c = edgeByte_[k];
+            uint32_t child = edgeTo_[k];
+            uint32_t f = fail_[n];
+            while (true){
+                auto b = edgeByte_.begin() + edgeStart_[f], e = edgeByte_.begin() + edgeStart_[f + 1];
+                auto it = std::lower_bound(b, e, c);
+                if (it != e && *it == c && edgeTo_[(size_t)(it - edgeByte_.begin())] != child){
+                    fail_[child] = edgeTo_[(size_t)(it - edgeByte_.begin())];
+                    break;
+                }
+                if (f == 0) break;
+                f = fail_[f];
+            }
+            outLink_[child] = match_[fail_[child]] >= 0 ? fail_[child] : outLink_[fail_[child]];
+            queue.push_back(child);
+        }
+    }
+}
+
+static bool is_boundary(char c){ return c == ' ' || c == ','; }
+
+void Dictionary::rewrite(std::string& s) const {
+    if (patterns_.empty() || s.empty()) return;
+    struct Hit { uint32_t start, len, pattern; };
+    thread_local std::vector<Hit> hits;
+    hits.clear();
+    uint32_t n = 0;
+    for (size_t i = 0; i < s.size(); ++i){
+        unsigned char c = (unsigned char)s[i];
+        while (true){
+            auto b = edgeByte_.begin() + edgeStart_[n], e = edgeByte_.begin() + edgeStart_[n + 1];
+            auto it = std::lower_bound(b, e, c);
+            if (it != e && *it == c){ n = edgeTo_[(size_t)(it - edgeByte_.begin())]; break; }
+            if (n == 0) break;
+            n = fail_[n];
+        }
+        // Every pattern ending here: the node's own, then its output chain
+        bool endOk = (i + 1 == s.size() || is_boundary(s[i + 1]));
+        if (!endOk) continue;
+        for (uint32_t m = match_[n] >= 0 ? n : outLink_[n]; m != 0; m = outLink_[m]){
+            uint32_t p = (uint32_t)match_[m];
+            uint32_t len = (uint32_t)patterns_[p].size();
+            size_t start = i + 1 - len;
+            if (start == 0 || is_boundary(s[start - 1])) hits.push_back(Hit{(uint32_t)start, len, p});
+        }
+    }
+    if (hits.empty()) return;
+    // Leftmost-longest, non-overlapping
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b){
+        return a.start != b.start ? a.start < b.start : a.len > b.len;
+    });
+    std::string out;
+    out.reserve(s.size() + 16);
+    size_t pos = 0;
+    for (const Hit& h : hits){
+        if (h.start < pos) continue;
+        out.append(s, pos, h.start - pos);
+        out += patterns_[replacement_[h.pattern]];
+        pos = h.start + h.len;
+    }
+    out.append(s, pos, std::string::npos);
+    s.swap(out);
+}
+
+std::shared_ptr<const Dictionary> current(){
+    return std::atomic_load(&g_current);
+}
+
+void publish(std::shared_ptr<const Dictionary> dict){
+    if (!dict) return;
+    std::atomic_store(&g_current, std::move(dict));
+}
+
+bool load(const fs::path& dataDir){
+    auto d = Dictionary::from_csv(dataDir / "aliases.csv");
+    if (!d) return false;
+    publish(std::move(d));
+    return true;
+}
+
+} // namespace aliases
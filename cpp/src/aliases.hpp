@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aliases {
+
+// Spelling variants of place names (data/aliases.csv: "alias,target" per line,
+// e.g. "jiddah,jeddah"). Both sides are folded with textnorm::fold when loaded.
+// All aliases are compiled into one Aho–Corasick automaton, so rewriting a query
+// is a single pass over it no matter how many variants there are.
+class Dictionary {
+public:
+    struct Entry { std::string alias; std::string target; };
+
+    // nullptr if the file cannot be read
+    static std::shared_ptr<const Dictionary> from_csv(const std::filesystem::path& csv);
+    // The same format from text in memory
+    static std::shared_ptr<const Dictionary> from_text(std::string_view text);
+    static std::shared_ptr<const Dictionary> from_entries(std::vector<Entry> entries);
+
+    // Replace every alias that forms whole words (bounded by the string edges,
+    // ' ' or ',') with its target, in place. Overlaps resolve leftmost-longest;
+    // replaced text is not scanned again. `s` must already be folded.
+    void rewrite(std::string& s) const;
+
+    // Aliases with their targets, in file order (targets are not included)
+    const std::vector<Entry>& entries() const { return entries_; }
+    size_t size() const { return entries_.size(); }
+
+private:
+    void build();
+
+    std::vector<Entry> entries_;
+    // Patterns: aliases, then each distinct target mapped to itself so a target
+    // that contains an alias ("al hofuf" vs "hofuf") is left alone
+    std::vector<std::string> patterns_;
+    std::vector<uint32_t> replacement_;    // pattern -> index into patterns_ of its target text
+    // Automaton in CSR form: node n's edges are [edgeStart_[n], edgeStart_[n+1])
+    // sorted by byte
+    std::vector<uint32_t> edgeStart_;
+    std::vector<unsigned char> edgeByte_;
+    std::vector<uint32_t> edgeTo_;
+    std::vector<uint32_t> fail_;
+    std::vector<int32_t> match_;           // pattern ending at the node, or -1
+    std::vector<uint32_t> outLink_;        // nearest proper suffix node with a match (0 = none)
+};
+
+// Dictionary published for the process (nullptr before the first load). Same
+// lifetime rules as hijri::current(): freed once replaced and no longer held.
+std::shared_ptr<const Dictionary> current();
+void publish(std::shared_ptr<const Dictionary> dict);
+
+// Load dataDir/aliases.csv and publish it; false if missing or unreadable
+bool load(const std::filesystem::path& dataDir);
+
+} // namespace aliases
@@ -0,0 +1,805 @@
+#include "citydb.hpp"
+#include "aliases.hpp"
+#include "platform.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace citydb {
+
+static const char kMagic[8] = {'A','L','M','C','I','D','X','\0'};
+
+// Distinct trigram keys of " s " (space padded so word edges count)
+static void trigram_keys(std::string_view s, std::vector<uint32_t>& out){
+    out.clear();
+    if (s.empty()) return;
+    std::string p; p.reserve(s.size() + 2);
+    p.push_back(' '); p.append(s.data(), s.size()); p.push_back(' ');
+    for (size_t i=0; i+3<=p.size(); ++i){
+        out.push_back(((uint32_t)(unsigned char)p[i] << 16) | ((uint32_t)(unsigned char)p[i+1] << 8) | (uint32_t)(unsigned char)p[i+2]);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kEarthKm = 6371.0;
+
+static void unit_vector(double lat, double lon, double v[3]){
+    double la = lat * kPi / 180.0, lo = lon * kPi / 180.0;
+    v[0] = std::cos(la) * std::cos(lo);
+    v[1] = std::cos(la) * std::sin(lo);
+    v[2] = std::sin(la);
+}
+
+static float axis_of(const KdNode& n, int axis){ return axis == 0 ? n.x : (axis == 1 ? n.y : n.z); }
+
+// Arrange nodes[lo, hi) so the median on `axis` sits in the middle, recursively
+static void build_kd(std::vector<KdNode>& nodes, size_t lo, size_t hi, int axis){
+    if (hi - lo <= 1) return;
+    size_t mid = lo + (hi - lo) / 2;
+    std::nth_element(nodes.begin() + (std::ptrdiff_t)lo, nodes.begin() + (std::ptrdiff_t)mid, nodes.begin() + (std::ptrdiff_t)hi,
+                     [axis](const KdNode& a, const KdNode& b){ return axis_of(a, axis) < axis_of(b, axis); });
+    build_kd(nodes, lo, mid, (axis + 1) % 3);
+    build_kd(nodes, mid + 1, hi, (axis + 1) % 3);
+}
+
+static uint64_t align4(uint64_t v){ return (v + 3) & ~(uint64_t)3; }
+
+ColumnLayout column_layout(uint32_t count, uint32_t countryCount, uint32_t tzCount){
+    ColumnLayout l{};
+    const uint64_t n = count;
+    uint64_t o = 0;
+    l.nameOff = o;     o += (n + 1) * sizeof(uint32_t);
+    l.normOff = o;     o += (n + 1) * sizeof(uint32_t);
+    l.lat = o;         o += n * sizeof(float);
+    l.lon = o;         o += n * sizeof(float);
+    l.normNameLen = o; o = align4(o + n * sizeof(uint16_t));
+    l.country = o;     o = align4(o + n * sizeof(uint16_t));
+    l.tz = o;          o = align4(o + n * sizeof(uint16_t));
+    l.countries = o;   o += (uint64_t)countryCount * sizeof(StrRef);
+    l.tzs = o;         o += (uint64_t)tzCount * sizeof(StrRef);
+    l.arOff = o;       o += (n + 1) * sizeof(uint32_t);
+    l.arNormOff = o;   o += (n + 1) * sizeof(uint32_t);
+    l.population = o;  o += n * sizeof(uint32_t);
+    l.end = o;
+    return l;
+}
+
+// Small-integer ids for repeated strings (countries, timezones)
+struct Interner {
+    std::unordered_map<std::string, uint16_t> ids;
+    std::vector<std::string> values;
+    uint16_t id(const std::string& v){
+        auto it = ids.find(v);
+        if (it != ids.end()) return it->second;
+        uint16_t i = (uint16_t)values.size();
+        ids.emplace(v, i);
+        values.push_back(v);
+        return i;
+    }
+};
+
+static std::vector<char> build_image(const CityTable& cities, const Sources& sources){
+    const size_t n = cities.size();
+    std::string pool;
+    std::vector<uint32_t> nameOff, normOff, arOff, arNormOff;
+    std::vector<float> lat(n), lon(n);
+    std::vector<uint16_t> normNameLen(n), country(n), tz(n);
+    Interner countries, tzs;
+    nameOff.reserve(n + 1); normOff.reserve(n + 1); arOff.reserve(n + 1); arNormOff.reserve(n + 1);
+    for (size_t i=0;i<n;++i){
+        nameOff.push_back((uint32_t)pool.size());
+        pool += cities.name[i];
+    }
+    nameOff.push_back((uint32_t)pool.size());
+    std::string both;
+    for (size_t i=0;i<n;++i){
+        both.assign(cities.name[i]); both += ", "; both += cities.country[i];
+        std::string full = normalize_str(both);
+        std::string nn = normalize_str(cities.name[i]);
+        // Normalization works word by word, so the name's form is a prefix of the full form
+        size_t common = 0;
+        while (common < nn.size() && common < full.size() && nn[common] == full[common]) ++common;
+        normOff.push_back((uint32_t)pool.size());
+        pool += full;
+        normNameLen[i] = (uint16_t)std::min<size_t>(common, 0xFFFF);
+        country[i] = countries.id(std::string(cities.country[i]));
+        tz[i] = tzs.id(std::string(cities.tz[i]));
+        lat[i] = (float)cities.lat[i]; lon[i] = (float)cities.lon[i];
+    }
+    normOff.push_back((uint32_t)pool.size());
+    for (size_t i=0;i<n;++i){
+        arOff.push_back((uint32_t)pool.size());
+        pool += cities.nameAr[i];
+    }
+    arOff.push_back((uint32_t)pool.size());
+    for (size_t i=0;i<n;++i){
+        arNormOff.push_back((uint32_t)pool.size());
+        pool += normalize_str(cities.nameAr[i]);
+    }
+    arNormOff.push_back((uint32_t)pool.size());
+    auto put_all = [&](const std::vector<std::string>& vals){
+        std::vector<StrRef> refs;
+        for (const auto& v : vals){ refs.push_back(StrRef{(uint32_t)pool.size(), (uint32_t)v.size()}); pool += v; }
+        return refs;
+    };
+    std::vector<StrRef> countryRefs = put_all(countries.values);
+    std::vector<StrRef> tzRefs = put_all(tzs.values);
+    auto norm_full = [&](size_t i){ return std::string_view(pool.data() + normOff[i], normOff[i+1] - normOff[i]); };
+    auto norm_ar = [&](size_t i){ return std::string_view(pool.data() + arNormOff[i], arNormOff[i+1] - arNormOff[i]); };
+
+    // Aliases whose target is a city's normalized (Latin or Arabic) name
+    std::vector<std::string> aliasTexts;
+    std::vector<std::vector<uint32_t>> cityAliases(n);
+    if (auto dict = aliases::current()){
+        std::unordered_multimap<std::string, uint32_t> byName;
+        for (size_t i=0;i<n;++i){
+            byName.emplace(std::string(norm_full(i).substr(0, normNameLen[i])), (uint32_t)i);
+            if (!norm_ar(i).empty()) byName.emplace(std::string(norm_ar(i)), (uint32_t)i);
+        }
+        for (const auto& e : dict->entries()){
+            auto range = byName.equal_range(e.target);
+            if (range.first == range.second) continue;
+            uint32_t ai = (uint32_t)aliasTexts.size();
+            aliasTexts.push_back(e.alias);
+            for (auto it = range.first; it != range.second; ++it) cityAliases[it->second].push_back(ai);
+        }
+    }
+    std::vector<uint32_t> aliasOff;
+    aliasOff.reserve(aliasTexts.size() + 1);
+    for (const auto& a : aliasTexts){ aliasOff.push_back((uint32_t)pool.size()); pool += a; }
+    aliasOff.push_back((uint32_t)pool.size());
+
+    // Posting lists: (key, city) pairs sorted by key, then grouped
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::vector<uint32_t> keys, arKeys;
+    for (size_t i=0;i<n;++i){
+        trigram_keys(norm_full(i), keys);
+        trigram_keys(norm_ar(i), arKeys);
+        keys.insert(keys.end(), arKeys.begin(), arKeys.end());
+        for (uint32_t ai : cityAliases[i]){
+            trigram_keys(aliasTexts[ai], arKeys);
+            keys.insert(keys.end(), arKeys.begin(), arKeys.end());
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (uint32_t k : keys) pairs.emplace_back(k, (uint32_t)i);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<TrigramEntry> tris;
+    std::vector<uint32_t> postings; postings.reserve(pairs.size());
+    for (size_t i=0;i<pairs.size();){
+        TrigramEntry e; e.key = pairs[i].first; e.first = (uint32_t)postings.size(); e.count = 0;
+        for (; i<pairs.size() && pairs[i].first == e.key; ++i){ postings.push_back(pairs[i].second); ++e.count; }
+        tris.push_back(e);
+    }
+    // Word starts of every normalized "name, country" and Arabic name, sorted by
+    // the text from there on. Arabic words are also keyed past the article "ال"
+    // so "رياض" finds "الرياض".
+    static const std::string kArticle = "\xD8\xA7\xD9\x84";
+    std::vector<PrefixEntry> prefixes;
+    for (size_t i=0;i<n;++i){
+        for (int ar=0; ar<2; ++ar){
+            std::string_view text = ar ? norm_ar(i) : norm_full(i);
+            for (uint32_t off=0; off<text.size(); ++off){
+                char ch = text[off];
+                if (ch == ' ' || ch == ',') continue;
+                if (off > 0 && text[off - 1] != ' ' && text[off - 1] != ',') continue;
+                uint32_t flag = ar ? kArabicKey : 0;
+                prefixes.push_back(PrefixEntry{(uint32_t)i, off | flag});
+                if (ar && text.compare(off, kArticle.size(), kArticle) == 0 && off + kArticle.size() < text.size())
+                    prefixes.push_back(PrefixEntry{(uint32_t)i, (uint32_t)(off + kArticle.size()) | flag});
+            }
+        }
+    }
+    for (size_t i=0;i<n;++i){
+        for (uint32_t ai : cityAliases[i]) prefixes.push_back(PrefixEntry{(uint32_t)i, ai | kAliasKey});
+    }
+    auto key = [&](const PrefixEntry& e){
+        if (e.off & kAliasKey) return std::string_view(aliasTexts[e.off & kKeyMask]);
+        if (e.off & kArabicKey) return norm_ar(e.city).substr(e.off & kKeyMask);
+        return norm_full(e.city).substr(e.off);
+    };
+    std::sort(prefixes.begin(), prefixes.end(), [&](const PrefixEntry& a, const PrefixEntry& b){
+        int c = key(a).compare(key(b));
+        return c != 0 ? c < 0 : a.city < b.city;
+    });
+
+    std::vector<KdNode> kd(n);
+    for (size_t i=0;i<n;++i){
+        double v[3]; unit_vector(lat[i], lon[i], v);
+        kd[i] = KdNode{(float)v[0], (float)v[1], (float)v[2], (uint32_t)i};
+    }
+    build_kd(kd, 0, kd.size(), 0);
+
+    FileHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.endianTag = kEndianTag;
+    h.count = (uint32_t)n;
+    h.countryCount = (uint32_t)countryRefs.size();
+    h.tzCount = (uint32_t)tzRefs.size();
+    const ColumnLayout l = column_layout(h.count, h.countryCount, h.tzCount);
+    h.columnsOffset = align4(sizeof(FileHeader));
+    h.poolOffset = h.columnsOffset + l.end;
+    h.poolSize = pool.size();
+    h.sourceSize = sources.csvSize;
+    h.sourceStamp = sources.csvStamp;
+    h.aliasSize = sources.aliasSize;
+    h.aliasStamp = sources.aliasStamp;
+    h.trigramOffset = align4(h.poolOffset + h.poolSize);
+    h.trigramCount = tris.size();
+    h.postingsOffset = h.trigramOffset + tris.size() * sizeof(TrigramEntry);
+    h.postingsCount = postings.size();
+    h.prefixOffset = h.postingsOffset + postings.size() * sizeof(uint32_t);
+    h.prefixCount = prefixes.size();
+    h.kdOffset = h.prefixOffset + prefixes.size() * sizeof(PrefixEntry);
+    h.kdCount = kd.size();
+    h.aliasCount = aliasTexts.size();
+    h.aliasOffset = h.kdOffset + kd.size() * sizeof(KdNode);
+
+    std::vector<char> img((size_t)(h.aliasOffset + aliasOff.size() * sizeof(uint32_t)));
+    auto put = [&](uint64_t off, const void* src, size_t bytes){ if (bytes) std::memcpy(img.data() + off, src, bytes); };
+    put(0, &h, sizeof(h));
+    const uint64_t c0 = h.columnsOffset;
+    put(c0 + l.nameOff, nameOff.data(), nameOff.size() * sizeof(uint32_t));
+    put(c0 + l.normOff, normOff.data(), normOff.size() * sizeof(uint32_t));
+    put(c0 + l.lat, lat.data(), n * sizeof(float));
+    put(c0 + l.lon, lon.data(), n * sizeof(float));
+    put(c0 + l.normNameLen, normNameLen.data(), n * sizeof(uint16_t));
+    put(c0 + l.country, country.data(), n * sizeof(uint16_t));
+    put(c0 + l.tz, tz.data(), n * sizeof(uint16_t));
+    put(c0 + l.countries, countryRefs.data(), countryRefs.size() * sizeof(StrRef));
+    put(c0 + l.tzs, tzRefs.data(), tzRefs.size() * sizeof(StrRef));
+    put(c0 + l.arOff, arOff.data(), arOff.size() * sizeof(uint32_t));
+    put(c0 + l.arNormOff, arNormOff.data(), arNormOff.size() * sizeof(uint32_t));
+    put(c0 + l.population, cities.population.data(), n * sizeof(uint32_t));
+    put(h.poolOffset, pool.data(), pool.size());
+    put(h.trigramOffset, tris.data(), tris.size() * sizeof(TrigramEntry));
+    put(h.postingsOffset, postings.data(), postings.size() * sizeof(uint32_t));
+    put(h.prefixOffset, prefixes.data(), prefixes.size() * sizeof(PrefixEntry));
+    put(h.kdOffset, kd.data(), kd.size() * sizeof(KdNode));
+    put(h.aliasOffset, aliasOff.data(), aliasOff.size() * sizeof(uint32_t));
+    return img;
+}
+
+bool Index::attach(const char* base, size_t size){
+    if (size < sizeof(FileHeader)) return false;
+    const FileHeader* h = reinterpret_cast<const FileHeader*>(base);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0) return false;
+    if (h->version != kVersion || h->endianTag != kEndianTag) return false;
+    const ColumnLayout l = column_layout(h->count, h->countryCount, h->tzCount);
+    if (h->columnsOffset + l.end > size) return false;
+    if (h->poolOffset + h->poolSize > size) return false;
+    if (h->trigramOffset + h->trigramCount * sizeof(TrigramEntry) > size) return false;
+    if (h->postingsOffset + h->postingsCount * sizeof(uint32_t) > size) return false;
+    if (h->prefixOffset + h->prefixCount * sizeof(PrefixEntry) > size) return false;
+    if (h->kdOffset + h->kdCount * sizeof(KdNode) > size) return false;
+    if (h->aliasOffset + (h->aliasCount + 1) * sizeof(uint32_t) > size) return false;
+    header_ = h;
+    const char* c0 = base + h->columnsOffset;
+    nameOff_ = reinterpret_cast<const uint32_t*>(c0 + l.nameOff);
+    normOff_ = reinterpret_cast<const uint32_t*>(c0 + l.normOff);
+    lat_ = reinterpret_cast<const float*>(c0 + l.lat);
+    lon_ = reinterpret_cast<const float*>(c0 + l.lon);
+    normNameLen_ = reinterpret_cast<const uint16_t*>(c0 + l.normNameLen);
+    country_ = reinterpret_cast<const uint16_t*>(c0 + l.country);
+    tz_ = reinterpret_cast<const uint16_t*>(c0 + l.tz);
+    countries_ = reinterpret_cast<const StrRef*>(c0 + l.countries);
+    tzs_ = reinterpret_cast<const StrRef*>(c0 + l.tzs);
+    arOff_ = reinterpret_cast<const uint32_t*>(c0 + l.arOff);
+    arNormOff_ = reinterpret_cast<const uint32_t*>(c0 + l.arNormOff);
+    population_ = reinterpret_cast<const uint32_t*>(c0 + l.population);
+    pool_ = base + h->poolOffset;
+    trigrams_ = reinterpret_cast<const TrigramEntry*>(base + h->trigramOffset);
+    postings_ = reinterpret_cast<const uint32_t*>(base + h->postingsOffset);
+    trigramCount_ = (size_t)h->trigramCount;
+    prefixes_ = reinterpret_cast<const PrefixEntry*>(base + h->prefixOffset);
+    prefixCount_ = (size_t)h->prefixCount;
+    kd_ = reinterpret_cast<const KdNode*>(base + h->kdOffset);
+    kdCount_ = (size_t)h->kdCount;
+    aliasOff_ = reinterpret_cast<const uint32_t*>(base + h->aliasOffset);
+    count_ = h->count;
+    return true;
+}
+
+std::optional<Index> Index::open(const fs::path& idx){
+    Index ix;
+    if (!ix.file_.open(idx)) return std::nullopt;
+    if (!ix.attach(ix.file_.data(), ix.file_.size())) return std::nullopt;
+    return std::optional<Index>(std::move(ix));
+}
+
+std::optional<Index> Index::from_image(std::string_view image){
+    Index ix;
+    if (!ix.attach(image.data(), image.size())) return std::nullopt;
+    return std::optional<Index>(std::move(ix));
+}
+
+Index Index::from_table(const CityTable& table){
+    Index ix;
+    ix.owned_ = build_image(table, Sources{});
+    ix.attach(ix.owned_.data(), ix.owned_.size());
+    return ix;
+}
+
+Index Index::from_cities(const std::vector<City>& cities){
+    return from_table(CityTable::of(cities));
+}
+
+bool Index::write(const CityTable& table, const fs::path& out, const Sources& sources, std::string* err){
+    std::vector<char> img = build_image(table, sources);
+    // A cache: rebuilt if lost, so not flushed
+    return platform::write_file_atomic(out, std::string_view(img.data(), img.size()), err, false);
+}
+
+City Index::city(size_t i) const {
+    City c;
+    c.name = std::string(name(i));
+    c.country = std::string(country(i));
+    c.tz = std::string(tz(i));
+    c.nameAr = std::string(name_ar(i));
+    c.population = population(i);
+    // Stored as float: round back to 1e-5 degrees (about a metre) so the
+    // CSV's decimals come out unchanged in config files and displays
+    c.lat = std::round(lat(i) * 1e5) / 1e5;
+    c.lon = std::round(lon(i) * 1e5) / 1e5;
+    return c;
+}
+
+std::vector<uint32_t> Index::trigram_candidates(std::string_view normQuery, size_t k) const {
+    std::vector<uint32_t> out;
+    if (!trigramCount_ || k == 0) return out;
+    thread_local std::vector<uint32_t> keys;
+    trigram_keys(normQuery, keys);
+
+    // Posting spans for the query's trigrams, rarest first
+    std::vector<const TrigramEntry*> spans;
+    for (uint32_t key : keys){
+        const TrigramEntry* e = std::lower_bound(trigrams_, trigrams_ + trigramCount_, key,
+                                                 [](const TrigramEntry& t, uint32_t v){ return t.key < v; });
+        if (e != trigrams_ + trigramCount_ && e->key == key) spans.push_back(e);
+    }
+    if (spans.empty()) return out;
+    std::sort(spans.begin(), spans.end(), [](const TrigramEntry* a, const TrigramEntry* b){ return a->count < b->count; });
+
+    // Dense per-city counters reused across queries; `touched` lists ids to score and reset
+    thread_local std::vector<uint8_t> counts;
+    thread_local std::vector<uint32_t> touched;
+    if (counts.size() < count_) counts.assign(count_, 0);
+    touched.clear();
+    // Very common trigrams add little once a few rare ones have narrowed the set
+    const size_t commonDf = std::max<size_t>(50000, count_ / 8);
+    for (size_t si=0; si<spans.size(); ++si){
+        const TrigramEntry* e = spans[si];
+        if (si >= 2 && e->count > commonDf) break;
+        for (uint32_t j=0; j<e->count; ++j){
+            uint32_t id = postings_[e->first + j];
+            if (counts[id] == 0) touched.push_back(id);
+            if (counts[id] < 255) ++counts[id];
+        }
+    }
+
+    const size_t qlen = normQuery.size();
+    // Closeness in length to whichever name (Latin or Arabic) is nearer
+    auto len_gap = [&](uint32_t id){
+        auto gap = [qlen](size_t l){ return l > qlen ? l - qlen : qlen - l; };
+        size_t g = gap(norm_full(id).size());
+        if (!norm_ar(id).empty()) g = std::min(g, gap(norm_ar(id).size()));
+        return g;
+    };
+    auto better = [&](uint32_t a, uint32_t b){
+        if (counts[a] != counts[b]) return counts[a] > counts[b];
+        size_t da = len_gap(a), db = len_gap(b);
+        if (da != db) return da < db;
+        return a < b;
+    };
+    if (touched.size() > k){
+        std::nth_element(touched.begin(), touched.begin() + (std::ptrdiff_t)k, touched.end(), better);
+        out.assign(touched.begin(), touched.begin() + (std::ptrdiff_t)k);
+    } else {
+        out = touched;
+    }
+    std::sort(out.begin(), out.end(), better);
+    for (uint32_t id : touched) counts[id] = 0;
+    return out;
+}
+
+std::pair<size_t, size_t> Index::prefix_range(std::string_view normPrefix, size_t lo, size_t hi) const {
+    hi = std::min(hi, prefixCount_);
+    lo = std::min(lo, hi);
+    // Compare only the first |prefix| bytes of each key: the matching entries
+    // are exactly those that compare equal, and they are contiguous.
+    auto head = [&](const PrefixEntry& e){ return key_text(e).substr(0, normPrefix.size()); };
+    const PrefixEntry* first = std::lower_bound(prefixes_ + lo, prefixes_ + hi, normPrefix,
+        [&](const PrefixEntry& e, std::string_view p){ return head(e) < p; });
+    const PrefixEntry* last = std::upper_bound(first, prefixes_ + hi, normPrefix,
+        [&](std::string_view p, const PrefixEntry& e){ return p < head(e); });
+    return { (size_t)(first - prefixes_), (size_t)(last - prefixes_) };
+}
+
+std::vector<Neighbor> Index::nearest(double lat, double lon, size_t k, double maxKm) const {
+    std::vector<Neighbor> out;
+    if (!kdCount_ || k == 0 || maxKm < 0) return out;
+    double q[3]; unit_vector(lat, lon, q);
+    // Search in squared chord length; a little slack covers the float nodes
+    double maxChord = maxKm >= kPi * kEarthKm ? 2.0 : 2.0 * std::sin(maxKm / (2.0 * kEarthKm));
+    double bound = maxChord * maxChord + 1e-9;
+    std::vector<std::pair<double, uint32_t>> best; // max-heap on distance, size <= k
+    best.reserve(k + 1);
+
+    struct Range { size_t lo, hi; int axis; };
+    Range stack[128]; // depth is at most ~2*log2(count)
+    int sp = 0;
+    stack[sp++] = Range{0, kdCount_, 0};
+    while (sp > 0){
+        Range r = stack[--sp];
+        if (r.lo >= r.hi) continue;
+        size_t mid = r.lo + (r.hi - r.lo) / 2;
+        const KdNode& n = kd_[mid];
+        double dx = q[0] - n.x, dy = q[1] - n.y, dz = q[2] - n.z;
+        double d2 = dx*dx + dy*dy + dz*dz;
+        if (d2 <= bound){
+            best.emplace_back(d2, n.city);
+            std::push_heap(best.begin(), best.end());
+            if (best.size() > k){ std::pop_heap(best.begin(), best.end()); best.pop_back(); }
+            if (best.size() == k) bound = std::min(bound, best.front().first);
+        }
+        double diff = q[r.axis] - axis_of(n, r.axis);
+        int next = (r.axis + 1) % 3;
+        Range nearSide = diff < 0 ? Range{r.lo, mid, next} : Range{mid + 1, r.hi, next};
+        Range farSide = diff < 0 ? Range{mid + 1, r.hi, next} : Range{r.lo, mid, next};
+        // Far side first on the stack so the near side is searched first
+        if (diff * diff <= bound) stack[sp++] = farSide;
+        stack[sp++] = nearSide;
+    }
+    std::sort(best.begin(), best.end());
+    out.reserve(best.size());
+    for (const auto& b : best){
+        double km = distance_km(lat, lon, lat_[b.second], lon_[b.second]);
+        if (km <= maxKm) out.push_back(Neighbor{b.second, km});
+    }
+    return out;
+}
+
+double distance_km(double lat1, double lon1, double lat2, double lon2){
+    double p1 = lat1 * kPi / 180.0, p2 = lat2 * kPi / 180.0;
+    double dp = p2 - p1, dl = (lon2 - lon1) * kPi / 180.0;
+    double a = std::sin(dp / 2) * std::sin(dp / 2) + std::cos(p1) * std::cos(p2) * std::sin(dl / 2) * std::sin(dl / 2);
+    return 2.0 * kEarthKm * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+// Parse "lat,lon" at the start of a line; false if it does not start with two numbers
+static bool parse_point(const char* p, const char* end, double& lat, double& lon){
+    char* e = nullptr;
+    lat = std::strtod(p, &e);
+    if (e == p || e >= end || *e != ',') return false;
+    p = e + 1;
+    lon = std::strtod(p, &e);
+    if (e == p || e > end) return false;
+    return lat >= -90 && lat <= 90 && lon >= -180 && lon <= 180;
+}
+
+// Snap the whole lines in [p, end) into `out`; returns snapped count
+static long snap_block(const Index& db, const char* p, const char* end, double maxKm, std::string& out){
+    long snapped = 0;
+    char num[32];
+    while (p < end){
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        const char* lineEnd = nl ? nl : end;
+        const char* trimmed = (lineEnd > p && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+        out.append(p, trimmed);
+        double lat, lon;
+        std::vector<Neighbor> hit;
+        if (parse_point(p, trimmed, lat, lon)) hit = db.nearest(lat, lon, 1, maxKm);
+        if (!hit.empty()){
+            uint32_t c = hit[0].city;
+            out += ','; out.append(db.name(c)); out += ','; out.append(db.country(c));
+            out += ','; out.append(db.tz(c));
+            int n = std::snprintf(num, sizeof(num), ",%.1f", hit[0].km);
+            out.append(num, (size_t)n);
+            ++snapped;
+        } else {
+            out += ",,,,";
+        }
+        out += '\n';
+        p = nl ? nl + 1 : end;
+    }
+    return snapped;
+}
+
+long snap_points(const Index& db, std::istream& in, std::ostream& out, double maxKm, unsigned threads){
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t blockBytes = (size_t)8 << 20;
+    std::string buf, carry;
+    std::vector<std::string> outs(threads);
+    long snapped = 0;
+    bool first = true;
+    while (in){
+        buf.swap(carry);
+        carry.clear();
+        size_t have = buf.size();
+        buf.resize(have + blockBytes);
+        in.read(&buf[have], (std::streamsize)blockBytes);
+        buf.resize(have + (size_t)in.gcount());
+        if (buf.empty()) break;
+        // Keep a trailing partial line for the next block
+        if (in){
+            size_t cut = buf.rfind('\n');
+            if (cut == std::string::npos){ carry.swap(buf); continue; }
+            carry.assign(buf, cut + 1, std::string::npos);
+            buf.resize(cut + 1);
+        }
+        const char* p = buf.c_str();
+        const char* end = p + buf.size();
+        if (first){
+            first = false;
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', buf.size()));
+            const char* lineEnd = nl ? nl : end;
+            const char* trimmed = (lineEnd > p && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+            double lat, lon;
+            if (!parse_point(p, trimmed, lat, lon)){
+                out.write(p, trimmed - p);
+                out << ",city,country,tz,km\n";
+                p = nl ? nl + 1 : end;
+            }
+        }
+        // Split at line boundaries, one slice per thread, and write the slices in order
+        std::vector<const char*> cuts{p};
+        for (unsigned t=1;t<threads;++t){
+            const char* c = p + (size_t)(end - p) * t / threads;
+            if (c < cuts.back()) c = cuts.back();
+            const char* nl = static_cast<const char*>(std::memchr(c, '\n', (size_t)(end - c)));
+            cuts.push_back(nl ? nl + 1 : end);
+        }
+        cuts.push_back(end);
+        std::vector<long> counts(threads, 0);
+        std::vector<std::thread> pool;
+        for (unsigned t=0;t<threads;++t){
+            outs[t].clear();
+            if (cuts[t] >= cuts[t+1]) continue;
+            pool.emplace_back([&, t]{ counts[t] = snap_block(db, cuts[t], cuts[t+1], maxKm, outs[t]); });
+        }
+        for (auto& th : pool) th.join();
+        for (unsigned t=0;t<threads;++t){ out.write(outs[t].data(), (std::streamsize)outs[t].size()); snapped += counts[t]; }
+    }
+    return snapped;
+}
+
+// Field with surrounding blanks (and a CRLF line's '\r') removed
+static std::string_view trim_field(std::string_view s){
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+static bool parse_coord(std::string_view s, double lo, double hi, double& v){
+    if (!s.empty() && s.front() == '+') s.remove_prefix(1);
+    auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size() && v >= lo && v <= hi;
+}
+
+// One newline-aligned slice of the file. Error line numbers are relative to
+// the slice until the slices are merged.
+struct CsvChunk {
+    CityTable rows;
+    std::vector<CsvError> errors;
+    size_t lines = 0;
+};
+
+static void parse_csv_chunk(const char* p, const char* end, CsvChunk& out){
+    CityTable& t = out.rows;
+    std::string_view f[7];
+    while (p < end){
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        std::string_view line(p, (size_t)((nl ? nl : end) - p));
+        p = nl ? nl + 1 : end;
+        ++out.lines;
+        std::string_view trimmed = trim_field(line);
+        if (trimmed.empty() || trimmed.front() == '#') continue;
+        size_t nf = 0, start = 0;
+        while (nf < 7){
+            size_t comma = line.find(',', start);
+            f[nf++] = trim_field(line.substr(start, comma == std::string_view::npos ? comma : comma - start));
+            if (comma == std::string_view::npos) break;
+            start = comma + 1;
+        }
+        double lat = 0, lon = 0;
+        uint32_t population = 0;
+        std::string bad;
+        if (nf < 4) bad = "expected name,country,lat,lon[,tz[,name_ar[,population]]]";
+        else if (f[0].empty()) bad = "empty city name";
+        else if (!parse_coord(f[2], -90, 90, lat)) bad = "bad latitude '" + std::string(f[2]) + "'";
+        else if (!parse_coord(f[3], -180, 180, lon)) bad = "bad longitude '" + std::string(f[3]) + "'";
+        else if (nf > 6 && !f[6].empty()){
+            auto r = std::from_chars(f[6].data(), f[6].data() + f[6].size(), population);
+            if (r.ec != std::errc() || r.ptr != f[6].data() + f[6].size()) bad = "bad population '" + std::string(f[6]) + "'";
+        }
+        if (!bad.empty()){ out.errors.push_back(CsvError{out.lines, std::move(bad)}); continue; }
+        t.name.push_back(f[0]);
+        t.country.push_back(f[1]);
+        t.lat.push_back(lat);
+        t.lon.push_back(lon);
+        t.tz.push_back(nf > 4 ? f[4] : std::string_view());
+        t.nameAr.push_back(nf > 5 ? f[5] : std::string_view());
+        t.population.push_back(population);
+    }
+}
+
+template <class T>
+static void append_column(std::vector<T>& dst, const std::vector<T>& src){
+    dst.insert(dst.end(), src.begin(), src.end());
+}
+
+std::optional<CityTable> CityTable::open(const fs::path& csv, unsigned threads){
+    platform::MappedFile file;
+    if (!file.open(csv)) return std::nullopt;
+    // The columns point into the mapping, which does not move with the object
+    CityTable t = parse(std::string_view(file.data(), file.size()), threads);
+    t.file_ = std::move(file);
+    return std::optional<CityTable>(std::move(t));
+}
+
+CityTable CityTable::parse(std::string_view text, unsigned threads){
+    CityTable t;
+    const char* p = text.data();
+    const char* end = p + text.size();
+    if (end - p >= 3 && (unsigned char)p[0] == 0xEF && (unsigned char)p[1] == 0xBB && (unsigned char)p[2] == 0xBF) p += 3;
+    // Header: a first line naming the name and lat columns
+    size_t firstLine = 1;
+    {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        std::string head(p, (size_t)((nl ? nl : end) - p));
+        for (char& c : head) c = (char)std::tolower((unsigned char)c);
+        if (head.find("name") != std::string::npos && head.find("lat") != std::string::npos){
+            p = nl ? nl + 1 : end;
+            firstLine = 2;
+        }
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // Small files are not worth a thread each: at least 1 MB per chunk
+    const size_t minChunk = (size_t)1 << 20;
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, (size_t)(end - p) / minChunk));
+    std::vector<const char*> cuts{p};
+    for (unsigned c=1;c<threads;++c){
+        const char* at = p + (size_t)(end - p) * c / threads;
+        if (at < cuts.back()) at = cuts.back();
+        const char* nl = static_cast<const char*>(std::memchr(at, '\n', (size_t)(end - at)));
+        cuts.push_back(nl ? nl + 1 : end);
+    }
+    cuts.push_back(end);
+    std::vector<CsvChunk> chunks(threads);
+    if (threads == 1){
+        parse_csv_chunk(cuts[0], cuts[1], chunks[0]);
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned c=0;c<threads;++c){
+            pool.emplace_back([&, c]{ parse_csv_chunk(cuts[c], cuts[c+1], chunks[c]); });
+        }
+        for (auto& th : pool) th.join();
+    }
+
+    // Merge in file order
+    size_t total = 0;
+    for (const auto& c : chunks) total += c.rows.size();
+    for (auto* col : {&t.name, &t.country, &t.tz, &t.nameAr}) col->reserve(total);
+    t.lat.reserve(total); t.lon.reserve(total); t.population.reserve(total);
+    size_t line = firstLine - 1;
+    for (const auto& c : chunks){
+        append_column(t.name, c.rows.name);
+        append_column(t.country, c.rows.country);
+        append_column(t.tz, c.rows.tz);
+        append_column(t.nameAr, c.rows.nameAr);
+        append_column(t.lat, c.rows.lat);
+        append_column(t.lon, c.rows.lon);
+        append_column(t.population, c.rows.population);
+        for (const auto& e : c.errors) t.errors_.push_back(CsvError{line + e.line, e.message});
+        line += c.lines;
+    }
+    return t;
+}
+
+CityTable CityTable::of(const std::vector<City>& cities){
+    CityTable t;
+    for (const auto& c : cities){
+        t.name.push_back(c.name);
+        t.country.push_back(c.country);
+        t.tz.push_back(c.tz);
+        t.nameAr.push_back(c.nameAr);
+        t.lat.push_back(c.lat);
+        t.lon.push_back(c.lon);
+        t.population.push_back(c.population);
+    }
+    return t;
+}
+
+std::pair<uint64_t, int64_t> source_stamp(const fs::path& csv){
+    std::error_code ec;
+    auto sz = fs::file_size(csv, ec);
+    if (ec) return {0, 0};
+    auto t = fs::last_write_time(csv, ec);
+    if (ec) return {0, 0};
+    return {(uint64_t)sz, (int64_t)t.time_since_epoch().count()};
+}
+
+// The process-wide database behind load() and load_text()
+static std::unique_ptr<Index> db;
+
+static void report_csv_errors(const std::string& source, const CityTable& table){
+    if (table.errors().empty()) return;
+    const CsvError& e = table.errors().front();
+    std::cerr << source << ":" << e.line << ": " << e.message;
+    if (table.errors().size() > 1) std::cerr << " (and " << table.errors().size() - 1 << " more malformed lines)";
+    std::cerr << "\n";
+}
+
+const Index& load(const fs::path& dataDir){
+    if (db) return *db;
+    if (!aliases::current()) aliases::load(dataDir);
+    fs::path csv = dataDir / "cities.csv";
+    auto stamp = source_stamp(csv);
+    auto aliasStamp = source_stamp(dataDir / "aliases.csv");
+    if (auto ix = Index::open(dataDir / "cities.idx")){
+        const FileHeader& h = ix->header();
+        bool noCsv = (stamp.first == 0 && stamp.second == 0);
+        bool csvOk = noCsv || (h.sourceSize == stamp.first && h.sourceStamp == stamp.second);
+        bool aliasOk = h.aliasSize == aliasStamp.first && h.aliasStamp == aliasStamp.second;
+        if (csvOk && (noCsv || aliasOk)){
+            db = std::make_unique<Index>(std::move(*ix));
+            return *db;
+        }
+    }
+    std::optional<CityTable> table = CityTable::open(csv);
+    if (!table){ db = std::make_unique<Index>(Index::from_cities({})); return *db; }
+    report_csv_errors(csv.string(), *table);
+    db = std::make_unique<Index>(Index::from_table(*table));
+    return *db;
+}
+
+const Index& load_text(std::string_view csv, const std::string& source){
+    if (db) return *db;
+    CityTable table = CityTable::parse(csv);
+    report_csv_errors(source, table);
+    db = std::make_unique<Index>(Index::from_table(table));
+    return *db;
+}
+
+const Index* load_image(std::string_view image){
+    if (db) return db.get();
+    auto ix = Index::from_image(image);
+    if (!ix) return nullptr;
+    db = std::make_unique<Index>(std::move(*ix));
+    return db.get();
+}
+
+long build_index_file(const fs::path& dataDir, const fs::path& out, std::string* err, std::vector<CsvError>* rowErrors){
+    fs::path csv = dataDir / "cities.csv";
+    std::optional<CityTable> table = CityTable::open(csv);
+    if (table && rowErrors) *rowErrors = table->errors();
+    if (!table || table->size() == 0){ if (err) *err = "no cities read from " + csv.string(); return -1; }
+    aliases::load(dataDir);
+    auto stamp = source_stamp(csv);
+    auto aliasStamp = source_stamp(dataDir / "aliases.csv");
+    Sources sources{stamp.first, stamp.second, aliasStamp.first, aliasStamp.second};
+    if (!Index::write(*table, out, sources, err)) return -1;
+    return (long)table->size();
+}
+
+} // namespace citydb
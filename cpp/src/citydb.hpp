@@ -0,0 +1,290 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "platform.hpp"
+#include "ui.hpp"
+
+namespace citydb {
+
+// On-disk city index (data/cities.idx), produced by `al-muslim build-index`.
+// Little-endian, read in place through a memory map:
+//   FileHeader | per-city columns | interned country/tz StrRefs | string pool
+//   | TrigramEntry[trigramCount] (sorted by key) | uint32 postings
+//   | PrefixEntry[prefixCount] (sorted by key text) | KdNode[count]
+//   | uint32 aliasOff[aliasCount + 1]
+// One column per field (see ColumnLayout): 34 bytes per city plus its name
+// bytes, 22 without the Arabic name and population columns. Names are
+// normalized at build time, aliases included, so lookups never re-normalize.
+struct FileHeader {
+    char magic[8];          // "ALMCIDX\0"
+    uint32_t version;
+    uint32_t endianTag;     // kEndianTag as written by the builder
+    uint32_t count;
+    uint32_t countryCount;
+    uint32_t tzCount;
+    uint32_t reserved;
+    uint64_t columnsOffset;
+    uint64_t poolOffset;
+    uint64_t poolSize;
+    uint64_t sourceSize;    // size of the CSV the index was built from
+    int64_t sourceStamp;    // last-write time of that CSV (opaque tick count)
+    uint64_t trigramOffset;
+    uint64_t trigramCount;
+    uint64_t postingsOffset;
+    uint64_t postingsCount;
+    uint64_t prefixOffset;
+    uint64_t prefixCount;
+    uint64_t kdOffset;
+    uint64_t kdCount;
+    uint64_t aliasSize;     // size / last-write time of the aliases.csv used (0 if none)
+    int64_t aliasStamp;
+    uint64_t aliasCount;
+    uint64_t aliasOffset;
+};
+
+struct StrRef { uint32_t off; uint32_t len; };
+
+// Byte offsets of each column relative to FileHeader::columnsOffset; every
+// column starts 4-byte aligned. Offset columns hold count + 1 entries.
+struct ColumnLayout {
+    uint64_t nameOff;       // uint32[count + 1]: display names
+    uint64_t normOff;       // uint32[count + 1]: normalize_str(name + ", " + country)
+    uint64_t lat;           // float[count]
+    uint64_t lon;           // float[count]
+    uint64_t normNameLen;   // uint16[count]: normalize_str(name) is this prefix of the above
+    uint64_t country;       // uint16[count]: index into the country table
+    uint64_t tz;            // uint16[count]: index into the timezone table
+    uint64_t countries;     // StrRef[countryCount]
+    uint64_t tzs;           // StrRef[tzCount]
+    uint64_t arOff;         // uint32[count + 1]: Arabic names (may be empty)
+    uint64_t arNormOff;     // uint32[count + 1]: normalize_str(Arabic name)
+    uint64_t population;    // uint32[count]: 0 when unknown
+    uint64_t end;
+};
+ColumnLayout column_layout(uint32_t count, uint32_t countryCount, uint32_t tzCount);
+
+// Three bytes of the padded normalized name packed into the low 24 bits;
+// postings[first, first + count) are the ids of the cities containing it
+struct TrigramEntry { uint32_t key; uint32_t first; uint32_t count; };
+
+// Key text is norm_full(city) starting at byte `off`; norm_ar(city) from
+// `off` when kArabicKey is set; alias text number `off` when kAliasKey is set.
+// There is one entry per word start, so the cities whose words start with a
+// prefix form one contiguous range.
+struct PrefixEntry { uint32_t city; uint32_t off; };
+constexpr uint32_t kArabicKey = 0x80000000u;
+constexpr uint32_t kAliasKey = 0x40000000u;
+constexpr uint32_t kKeyMask = 0x3FFFFFFFu;
+
+// Size and last-write ticks of the files an index is built from ({0,0} if absent)
+struct Sources {
+    uint64_t csvSize = 0;
+    int64_t csvStamp = 0;
+    uint64_t aliasSize = 0;
+    int64_t aliasStamp = 0;
+};
+
+// Unit vector of a city's position: chord length orders like great-circle distance.
+// The array is an implicit balanced k-d tree (median of each range, axis x, y, z).
+struct KdNode { float x, y, z; uint32_t city; };
+
+constexpr uint32_t kVersion = 8;
+constexpr uint32_t kEndianTag = 0x01020304u;
+
+// A city and its great-circle distance from the query point
+struct Neighbor { uint32_t city; double km; };
+
+// A malformed data line of cities.csv (1-based line number)
+struct CsvError { size_t line; std::string message; };
+
+// Cities parsed from cities.csv, one column per field. The string columns view
+// the mapped file (or the strings they were built from), so a table is only
+// valid while it is alive and is move-only.
+class CityTable {
+public:
+    CityTable() = default;
+    CityTable(CityTable&&) = default;
+    CityTable& operator=(CityTable&&) = default;
+
+    // Map and parse a CSV ("name,country,lat,lon[,tz[,name_ar[,population]]]"). The BOM, a
+    // header line, blank lines and '#' comments are skipped; other lines without
+    // a name or valid coordinates are reported in errors(). The file is split at
+    // newlines into one chunk per thread (0 = hardware concurrency) and chunks
+    // are appended in file order, so the result does not depend on `threads`.
+    // std::nullopt if the file cannot be read.
+    static std::optional<CityTable> open(const std::filesystem::path& csv, unsigned threads = 0);
+    // Same for CSV text already in memory; the columns view `text`, which must
+    // outlive the table
+    static CityTable parse(std::string_view text, unsigned threads = 0);
+    // Columns viewing `cities` (which must outlive the table)
+    static CityTable of(const std::vector<City>& cities);
+
+    size_t size() const { return name.size(); }
+    const std::vector<CsvError>& errors() const { return errors_; }
+
+    std::vector<std::string_view> name, country, tz, nameAr;
+    std::vector<double> lat, lon;
+    std::vector<uint32_t> population;
+
+private:
+    platform::MappedFile file_;
+    std::vector<CsvError> errors_;
+};
+
+class CityRef;
+
+class Index {
+public:
+    Index() = default;
+    Index(Index&&) = default;
+    Index& operator=(Index&&) = default;
+
+    // Map an index file; std::nullopt if missing, truncated or from another version/endianness
+    static std::optional<Index> open(const std::filesystem::path& idx);
+    // View an index image in memory that outlives the Index (the copy compiled
+    // into the binary); same checks as open()
+    static std::optional<Index> from_image(std::string_view image);
+    // Build the same image in memory (no file); used when no current index exists
+    static Index from_table(const CityTable& table);
+    static Index from_cities(const std::vector<City>& cities);
+    // Serialize to disk atomically (temp file + rename)
+    static bool write(const CityTable& table, const std::filesystem::path& out,
+                      const Sources& sources, std::string* err = nullptr);
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    bool mapped() const { return file_.is_open(); }
+    const FileHeader& header() const { return *header_; }
+
+    std::string_view name(size_t i) const { return span(nameOff_, i); }
+    std::string_view country(size_t i) const { return str(countries_[country_[i]]); }
+    std::string_view tz(size_t i) const { return str(tzs_[tz_[i]]); }
+    std::string_view norm_name(size_t i) const { return span(normOff_, i).substr(0, normNameLen_[i]); }
+    std::string_view norm_full(size_t i) const { return span(normOff_, i); }
+    uint32_t population(size_t i) const { return population_[i]; }
+    std::string_view name_ar(size_t i) const { return span(arOff_, i); }
+    std::string_view norm_ar(size_t i) const { return span(arNormOff_, i); }
+    double lat(size_t i) const { return lat_[i]; }
+    double lon(size_t i) const { return lon_[i]; }
+    uint16_t country_id(size_t i) const { return country_[i]; }
+    uint16_t tz_id(size_t i) const { return tz_[i]; }
+
+    // Whole coordinate columns, for linear scans and bulk computation
+    const float* lats() const { return lat_; }
+    const float* lons() const { return lon_; }
+
+    // Handle to one city; City materializes it (for config writes and display)
+    CityRef ref(size_t i) const;
+    City city(size_t i) const;
+
+    // Up to k city ids sharing the most trigrams with an already-normalized query,
+    // best first (more shared trigrams, then closer length). Empty if the query
+    // has no indexed trigram.
+    std::vector<uint32_t> trigram_candidates(std::string_view normQuery, size_t k) const;
+
+    // Sorted word-start keys for type-ahead. prefix_range returns the half-open
+    // range of entries whose key starts with `normPrefix`, searching only inside
+    // [lo, hi) so a longer prefix can narrow the previous keystroke's range.
+    size_t prefix_count() const { return prefixCount_; }
+    uint32_t prefix_city(size_t k) const { return prefixes_[k].city; }
+    std::pair<size_t, size_t> prefix_range(std::string_view normPrefix, size_t lo, size_t hi) const;
+    std::string_view prefix_key(size_t k) const { return key_text(prefixes_[k]); }
+
+    // Up to k cities closest to (lat, lon) and no farther than maxKm, closest first
+    std::vector<Neighbor> nearest(double lat, double lon, size_t k = 1, double maxKm = 1e9) const;
+
+private:
+    bool attach(const char* base, size_t size);
+    std::string_view str(StrRef r) const { return std::string_view(pool_ + r.off, r.len); }
+    std::string_view key_text(const PrefixEntry& e) const {
+        if (e.off & kAliasKey) return span(aliasOff_, e.off & kKeyMask);
+        if (e.off & kArabicKey) return norm_ar(e.city).substr(e.off & kKeyMask);
+        return norm_full(e.city).substr(e.off);
+    }
+    std::string_view span(const uint32_t* offs, size_t i) const {
+        return std::string_view(pool_ + offs[i], offs[i + 1] - offs[i]);
+    }
+
+    platform::MappedFile file_;
+    std::vector<char> owned_;   // image built in memory (when not mapped)
+    const FileHeader* header_ = nullptr;
+    const uint32_t* nameOff_ = nullptr;
+    const uint32_t* normOff_ = nullptr;
+    const float* lat_ = nullptr;
+    const float* lon_ = nullptr;
+    const uint16_t* normNameLen_ = nullptr;
+    const uint16_t* country_ = nullptr;
+    const uint16_t* tz_ = nullptr;
+    const StrRef* countries_ = nullptr;
+    const StrRef* tzs_ = nullptr;
+    const uint32_t* arOff_ = nullptr;
+    const uint32_t* arNormOff_ = nullptr;
+    const uint32_t* population_ = nullptr;
+    const char* pool_ = nullptr;
+    const TrigramEntry* trigrams_ = nullptr;
+    const uint32_t* postings_ = nullptr;
+    size_t trigramCount_ = 0;
+    const PrefixEntry* prefixes_ = nullptr;
+    size_t prefixCount_ = 0;
+    const KdNode* kd_ = nullptr;
+    const uint32_t* aliasOff_ = nullptr;
+    size_t kdCount_ = 0;
+    size_t count_ = 0;
+};
+
+// Lightweight handle to one city of an Index: two words, no string copies.
+// Valid as long as the Index it came from.
+class CityRef {
+public:
+    CityRef(const Index& db, uint32_t id) : db_(&db), id_(id) {}
+    uint32_t id() const { return id_; }
+    std::string_view name() const { return db_->name(id_); }
+    std::string_view country() const { return db_->country(id_); }
+    std::string_view tz() const { return db_->tz(id_); }
+    std::string_view name_ar() const { return db_->name_ar(id_); }
+    double lat() const { return db_->lat(id_); }
+    double lon() const { return db_->lon(id_); }
+    City city() const { return db_->city(id_); }
+private:
+    const Index* db_;
+    uint32_t id_;
+};
+
+inline CityRef Index::ref(size_t i) const { return CityRef(*this, (uint32_t)i); }
+
+// Source stamp (size, last-write ticks) of a CSV file; {0,0} if missing
+std::pair<uint64_t, int64_t> source_stamp(const std::filesystem::path& csv);
+
+// The city database for dataDir, loaded once per process: cities.idx when it
+// matches cities.csv (or there is no CSV), otherwise cities.csv parsed into an
+// in-memory index. Empty index if neither exists.
+const Index& load(const std::filesystem::path& dataDir);
+// The same, built from CSV text in memory (the copy compiled into the binary);
+// `source` names it in error messages. Whichever of the two runs first wins.
+const Index& load_text(std::string_view csv, const std::string& source);
+// The same from a prebuilt image (see Index::from_image); nullptr, and nothing
+// loaded, if the image does not attach
+const Index* load_image(std::string_view image);
+
+// Great-circle distance in km (spherical Earth, R = 6371 km)
+double distance_km(double lat1, double lon1, double lat2, double lon2);
+
+// Bulk reverse lookup: reads "lat,lon[,...]" lines and writes each line back with
+// ",city,country,tz,km" of the nearest city within maxKm appended (empty fields
+// when there is none or the line does not start with two numbers). A first line
+// that is not numeric is treated as a header. Lines are processed in parallel
+// blocks; output order matches input. Returns the number of snapped lines.
+long snap_points(const Index& db, std::istream& in, std::ostream& out, double maxKm, unsigned threads = 0);
+
+// Compile dataDir/cities.csv into `out`. Returns number of cities, or -1.
+// Malformed lines are skipped and, if `rowErrors` is given, listed there.
+long build_index_file(const std::filesystem::path& dataDir, const std::filesystem::path& out, std::string* err = nullptr,
+                      std::vector<CsvError>* rowErrors = nullptr);
+
+} // namespace citydb
@@ -0,0 +1,190 @@
+#include "daycache.hpp"
+#include "platform.hpp"
+#include "resources.hpp"
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace daycache {
+
+static const char kMagic[8] = {'A','L','M','D','A','Y','\0','\0'};
+static constexpr uint32_t kVersion = 2;
+
+// One day of output, strings NUL-terminated
+struct DayRecord {
+    int32_t date;               // YYYYMMDD; 0 = empty
+    int32_t utcOffsetMin;
+    double hours[6];
+    char dateStr[12];
+    char times[6][12];
+    char hijri[112];
+};
+
+// The whole file; written and read as one block in native byte order (a
+// cache from another machine just misses on the magic or the size)
+struct Record {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;              // sizeof(Record)
+    uint64_t pathHash;          // Stamp of the config the days were computed from
+    uint64_t configSize;
+    int64_t configMtime;
+    uint64_t configHash;
+    uint64_t dataId;            // data_id() when the days were computed
+    uint32_t systemZone;        // offsets must match the current one
+    uint32_t arabic;
+    char city[160];
+    DayRecord days[2];          // today, tomorrow
+};
+
+// FNV-1a, 64-bit
+static uint64_t fnv1a(const void* data, size_t n, uint64_t h = 1469598103934665603ull){
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i){ h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+Stamp stamp(const fs::path& config){
+    Stamp s;
+    std::error_code ec;
+    fs::directory_entry e(config, ec);   // one stat; the getters below reuse it
+    if (ec || !e.is_regular_file(ec)) return s;
+    s.size = e.file_size(ec);
+    if (ec) return Stamp{};
+    s.mtime = (int64_t)e.last_write_time(ec).time_since_epoch().count();
+    if (ec) return Stamp{};
+    const auto& native = config.native();
+    s.pathHash = fnv1a(native.data(), native.size() * sizeof(native[0]));
+    return s;
+}
+
+uint64_t config_hash(const settings::Config& cfg){
+    uint64_t h = fnv1a(&kVersion, sizeof(kVersion));
+    auto str = [&](const std::string& v){ uint64_t n = v.size(); h = fnv1a(&n, sizeof(n), h); h = fnv1a(v.data(), v.size(), h); };
+    auto num = [&](std::optional<double> v){ double d = v.value_or(-1e300); h = fnv1a(&d, sizeof(d), h); };
+    str(cfg.city);
+    num(cfg.latitude); num(cfg.longitude);
+    str(cfg.timezone);
+    num(cfg.elevationM);
+    str(cfg.method); str(cfg.madhab); str(cfg.highLatRule);
+    num(cfg.fajrAngle); num(cfg.ishaAngle);
+    uint32_t flags = (cfg.arabic() ? 1u : 0u) | (cfg.use24h ? 2u : 0u);
+    h = fnv1a(&flags, sizeof(flags), h);
+    return h;
+}
+
+uint64_t data_id(){
+    auto mix = [](const Stamp& s, uint64_t h){
+        h = fnv1a(&s.pathHash, sizeof(s.pathHash), h);
+        h = fnv1a(&s.size, sizeof(s.size), h);
+        return fnv1a(&s.mtime, sizeof(s.mtime), h);
+    };
+    uint64_t h = mix(stamp(platform::executable_path()), fnv1a(&kVersion, sizeof(kVersion)));
+    fs::path hijri = resources::find("hijri/umm_al_qura_month_starts.csv");
+    return hijri.empty() ? h : mix(stamp(hijri), h);
+}
+
+fs::path default_path(){
+    return platform::cache_dir() / "today.bin";
+}
+
+int date_key(const std::tm& date){
+    return ((date.tm_year + 1900) * 100 + date.tm_mon + 1) * 100 + date.tm_mday;
+}
+
+template <size_t N>
+static bool put(char (&dst)[N], const std::string& s){
+    if (s.size() >= N) return false;
+    std::memcpy(dst, s.data(), s.size());
+    return true;
+}
+
+template <size_t N>
+static std::string get(const char (&src)[N]){
+    return std::string(src, strnlen(src, N));
+}
+
+// "2026-10-18" -> 20261018
+static int date_number(const std::string& iso){
+    int n = 0;
+    for (char c : iso) if (c >= '0' && c <= '9') n = n * 10 + (c - '0');
+    return n;
+}
+
+static bool to_record(DayRecord& r, const oneshot::Day& d, int utcOffsetMin){
+    r.date = date_number(d.date);
+    r.utcOffsetMin = utcOffsetMin;
+    for (int i = 0; i < 6; ++i){
+        r.hours[i] = d.hours[i];
+        if (!put(r.times[i], d.times[i])) return false;
+    }
+    return put(r.dateStr, d.date) && put(r.hijri, d.hijri);
+}
+
+static oneshot::Day from_record(const Record& rec, const DayRecord& r){
+    oneshot::Day d;
+    d.date = get(r.dateStr);
+    d.hijri = get(r.hijri);
+    d.city = get(rec.city);
+    d.arabic = rec.arabic != 0;
+    for (int i = 0; i < 6; ++i){
+        d.hours[i] = r.hours[i];
+        d.times[i] = get(r.times[i]);
+    }
+    return d;
+}
+
+std::optional<Hit> lookup(const fs::path& file, const Key& key){
+    platform::MappedFile f;
+    if (!f.open(file) || f.size() != sizeof(Record)) return std::nullopt;
+    Record rec;
+    std::memcpy(&rec, f.data(), sizeof(rec));
+    if (std::memcmp(rec.magic, kMagic, sizeof(kMagic)) != 0 || rec.version != kVersion || rec.size != sizeof(Record))
+        return std::nullopt;
+    if (rec.dataId != key.dataId) return std::nullopt;
+    if (key.configHash){
+        if (rec.configHash != *key.configHash) return std::nullopt;
+    } else if (rec.pathHash != key.stamp.pathHash || rec.configSize != key.stamp.size || rec.configMtime != key.stamp.mtime){
+        return std::nullopt;
+    }
+    auto usable = [&](const DayRecord& d, int date){
+        return d.date == date && (!rec.systemZone || d.utcOffsetMin == key.utcOffsetMin);
+    };
+    for (int i = 0; i < 2; ++i){
+        if (!usable(rec.days[i], key.date)) continue;
+        Hit hit{from_record(rec, rec.days[i]), std::nullopt};
+        if (i == 0 && rec.days[1].date != 0 && (!rec.systemZone || rec.days[1].utcOffsetMin == key.utcOffsetMin))
+            hit.tomorrow = from_record(rec, rec.days[1]);
+        return hit;
+    }
+    return std::nullopt;
+}
+
+bool store(const fs::path& file, const Key& key, uint64_t configHash, bool systemZone,
+           const oneshot::Day& today, const oneshot::Day& tomorrow){
+    Record rec;
+    std::memset(&rec, 0, sizeof(rec));
+    std::memcpy(rec.magic, kMagic, sizeof(kMagic));
+    rec.version = kVersion;
+    rec.size = sizeof(Record);
+    rec.pathHash = key.stamp.pathHash;
+    rec.configSize = key.stamp.size;
+    rec.configMtime = key.stamp.mtime;
+    rec.configHash = configHash;
+    rec.dataId = key.dataId;
+    rec.systemZone = systemZone ? 1 : 0;
+    rec.arabic = today.arabic ? 1 : 0;
+    if (!put(rec.city, today.city)) return false;
+    if (!to_record(rec.days[0], today, key.utcOffsetMin)) return false;
+    if (!to_record(rec.days[1], tomorrow, key.utcOffsetMin)) return false;
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    return platform::write_file_atomic(file, std::string_view(reinterpret_cast<const char*>(&rec), sizeof(rec)),
+                                       nullptr, /*durable=*/false);
+}
+
+} // namespace daycache
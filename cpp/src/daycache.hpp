@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "oneshot.hpp"
+#include "settings.hpp"
+
+// On-disk cache of the --once output for today and tomorrow (today.bin in
+// platform::cache_dir()), so repeat runs from status bars and login hooks
+// skip the config parse, the Hijri table and the prayer-time computation.
+//
+// The file is one fixed-size record, read with a single mmap. It is keyed by
+// the config file's stamp (path, size, mtime) and by a hash of the typed
+// Config: an unchanged stamp is trusted without parsing the config, and a
+// touched but equivalent config still hits once parsed. Each day also
+// records the UTC offset it was computed with, which must still apply when
+// the config leaves the timezone to the system (a DST switch misses). A
+// rebuilt binary or an edited Hijri table also misses (see data_id).
+namespace daycache {
+
+// Identity of the config file, from one stat; all zero if it is missing
+struct Stamp {
+    uint64_t pathHash = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+Stamp stamp(const std::filesystem::path& config);
+
+// Hash of every Config field that shows up in the output
+uint64_t config_hash(const settings::Config& cfg);
+
+// Identity of everything else the output depends on: the executable's stamp
+// (a build id that changes with every rebuild) and the stamp of the Hijri
+// table override file, when there is one (otherwise the embedded copy, which
+// is part of the binary, is used)
+uint64_t data_id();
+
+std::filesystem::path default_path();
+
+struct Key {
+    Stamp stamp;
+    std::optional<uint64_t> configHash; // unset: trust a matching stamp
+    uint64_t dataId = 0;                // data_id()
+    int date = 0;                       // local date as YYYYMMDD
+    int utcOffsetMin = 0;               // current offset east of UTC
+};
+
+struct Hit {
+    oneshot::Day today;
+    std::optional<oneshot::Day> tomorrow;
+};
+
+// The cached entry for key.date (and the following day when cached), or
+// std::nullopt if the file is missing, from another version or stale
+std::optional<Hit> lookup(const std::filesystem::path& file, const Key& key);
+
+// Replace the cache with `today` and `tomorrow` (both with their Hijri date).
+// systemZone: the config has no timezone, so the offset is checked on lookup.
+// False if a value does not fit the record or the file cannot be written.
+bool store(const std::filesystem::path& file, const Key& key, uint64_t configHash, bool systemZone,
+           const oneshot::Day& today, const oneshot::Day& tomorrow);
+
+// YYYYMMDD for a broken-down local date
+int date_key(const std::tm& date);
+
+} // namespace daycache
@@ -0,0 +1,109 @@
+#include "editdist.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace editdist {
+
+namespace {
+
+// Per-byte match masks of the pattern; entries are cleared after each call
+// so only the pattern's own bytes are ever touched.
+struct Scratch {
+    uint64_t peq[256] = {};
+    std::vector<uint64_t> peqBlocks; // 256 * blocks for long patterns
+    std::vector<uint64_t> pv, mv;
+};
+
+Scratch& scratch(){
+    thread_local Scratch s;
+    return s;
+}
+
+constexpr int kUnbounded = -1;
+
+// Pattern p (m <= 64) against text t
+int myers_single(std::string_view p, std::string_view t, int maxDist){
+    Scratch& s = scratch();
+    const size_t m = p.size(), n = t.size();
+    for (size_t i=0;i<m;++i) s.peq[(unsigned char)p[i]] |= (uint64_t)1 << i;
+    const uint64_t last = (uint64_t)1 << (m - 1);
+    uint64_t pv = ~(uint64_t)0, mv = 0;
+    int score = (int)m;
+    for (size_t j=0;j<n;++j){
+        const uint64_t eq = s.peq[(unsigned char)t[j]];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last) ++score; else if (mh & last) --score;
+        ph = (ph << 1) | 1; // row 0 grows by one per column
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        // Each remaining column lowers the last row by at most one
+        if (maxDist != kUnbounded && score - (int)(n - j - 1) > maxDist){ score = maxDist + 1; break; }
+    }
+    for (size_t i=0;i<m;++i) s.peq[(unsigned char)p[i]] = 0;
+    return score;
+}
+
+// Block-based variant for patterns longer than one word. Each block passes
+// its horizontal delta (-1, 0, +1) at the top bit to the block below.
+int myers_blocks(std::string_view p, std::string_view t, int maxDist){
+    Scratch& s = scratch();
+    const size_t m = p.size(), n = t.size();
+    const size_t blocks = (m + 63) / 64;
+    if (s.peqBlocks.size() < 256 * blocks) s.peqBlocks.assign(256 * blocks, 0);
+    s.pv.assign(blocks, ~(uint64_t)0);
+    s.mv.assign(blocks, 0);
+    for (size_t i=0;i<m;++i) s.peqBlocks[(size_t)(unsigned char)p[i] * blocks + i / 64] |= (uint64_t)1 << (i % 64);
+    const uint64_t high = (uint64_t)1 << 63;
+    const uint64_t last = (uint64_t)1 << ((m - 1) % 64);
+    int score = (int)m;
+    for (size_t j=0;j<n;++j){
+        const uint64_t* peq = &s.peqBlocks[(size_t)(unsigned char)t[j] * blocks];
+        int hin = 1; // row 0 grows by one per column
+        for (size_t b=0;b<blocks;++b){
+            uint64_t pv = s.pv[b], mv = s.mv[b], eq = peq[b];
+            const uint64_t xv = eq | mv;
+            if (hin < 0) eq |= 1;
+            const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+            if (b + 1 == blocks){
+                if (ph & last) ++score; else if (mh & last) --score;
+            }
+            const int hout = (ph & high) ? 1 : ((mh & high) ? -1 : 0);
+            ph <<= 1; mh <<= 1;
+            if (hin < 0) mh |= 1; else if (hin > 0) ph |= 1;
+            s.pv[b] = mh | ~(xv | ph);
+            s.mv[b] = ph & xv;
+            hin = hout;
+        }
+        if (maxDist != kUnbounded && score - (int)(n - j - 1) > maxDist){ score = maxDist + 1; break; }
+    }
+    for (size_t i=0;i<m;++i) s.peqBlocks[(size_t)(unsigned char)p[i] * blocks + i / 64] = 0;
+    return score;
+}
+
+int distance(std::string_view a, std::string_view b, int maxDist){
+    // Distance is symmetric; the shorter string is the bit-vector pattern
+    if (a.size() > b.size()) std::swap(a, b);
+    if (maxDist != kUnbounded && (int)(b.size() - a.size()) > maxDist) return maxDist + 1;
+    if (a.empty()) return (int)b.size();
+    return a.size() <= 64 ? myers_single(a, b, maxDist) : myers_blocks(a, b, maxDist);
+}
+
+} // namespace
+
+int levenshtein(std::string_view a, std::string_view b){
+    return distance(a, b, kUnbounded);
+}
+
+int levenshtein_bounded(std::string_view a, std::string_view b, int maxDist){
+    if (maxDist < 0) return maxDist + 1; // every distance exceeds it
+    return distance(a, b, maxDist);
+}
+
+} // namespace editdist
@@ -0,0 +1,17 @@
+#pragma once
+#include <string_view>
+
+namespace editdist {
+
+// Levenshtein distance over bytes (unit cost insert/delete/substitute).
+// Bit-parallel (Myers/Hyyrö): one 64-bit word per column when the shorter
+// string is at most 64 bytes, a chain of words otherwise. Uses thread-local
+// scratch, so no allocation per call once warmed up.
+int levenshtein(std::string_view a, std::string_view b);
+
+// Same distance, but gives up as soon as it is certain to exceed maxDist and
+// then returns maxDist + 1. Useful when only candidates that beat the current
+// best matter.
+int levenshtein_bounded(std::string_view a, std::string_view b, int maxDist);
+
+} // namespace editdist
@@ -0,0 +1,66 @@
+#include "frame.hpp"
+#include "platform.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace frame {
+
+static std::string fg256(int idx){
+    char buf[32]; std::snprintf(buf, sizeof(buf), "\x1b[38;5;%dm", idx);
+    return buf;
+}
+
+static std::string bg256(int idx){
+    char buf[32]; std::snprintf(buf, sizeof(buf), "\x1b[48;5;%dm", idx);
+    return buf;
+}
+
+Palette make_palette(bool color, int fg, int bg){
+    Palette p;
+    p.border = "\x1b[0m\x1b[90m";
+    if (!color) return p;
+    p.reset = "\x1b[0m";
+    p.bold = "\x1b[1m";
+    p.dim = "\x1b[2m";
+    if (bg >= 0) p.base += bg256(bg);
+    if (fg >= 0) p.base += fg256(fg);
+    p.resetBase = p.reset + p.base;
+    p.accent = p.bold + fg256(45);
+    p.highlight = p.bold + fg256(82);
+    p.grey = "\x1b[90m";
+    p.banner = "\x1b[32m";
+    p.hijri = "\x1b[36m";
+    return p;
+}
+
+void Writer::pad_left(std::string_view s, size_t width){
+    if (s.size() < width) buf_.append(width - s.size(), ' ');
+    *this << s;
+}
+
+void Writer::pad_right(std::string_view s, size_t width){
+    *this << s;
+    if (s.size() < width) buf_.append(width - s.size(), ' ');
+}
+
+int Writer::row() const {
+    return 1 + (int)std::count(buf_.begin(), buf_.end(), '\n');
+}
+
+bool Writer::flush(){
+    std::cout.flush();
+    std::fflush(stdout);
+    if (buf_.empty()) return true;
+    bool ok = platform::write_stdout(buf_);
+    buf_.clear();
+    return ok;
+}
+
+Writer& screen(){
+    static Writer w;
+    return w;
+}
+
+} // namespace frame
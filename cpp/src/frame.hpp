@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Screen output assembled in memory and written with one syscall per frame,
+// so a redraw over SSH or a serial console arrives in one piece instead of
+// as hundreds of small writes that flicker.
+namespace frame {
+
+// A theme's escape sequences, built once when the theme is; every string is
+// empty when colors are off
+struct Palette {
+    std::string reset;          // all attributes off
+    std::string bold;
+    std::string dim;
+    std::string base;           // the theme's own background/foreground, if set
+    std::string resetBase;      // reset, then base
+    std::string border;         // prayer table lines, also sent without colors
+    std::string grey;
+    std::string accent;         // table header
+    std::string highlight;      // next prayer row
+    std::string banner;         // logo
+    std::string hijri;          // Hijri date line
+};
+Palette make_palette(bool color, int fg, int bg);
+
+class Writer {
+public:
+    Writer& operator<<(std::string_view s){ buf_.append(s.data(), s.size()); return *this; }
+    Writer& operator<<(char c){ buf_.push_back(c); return *this; }
+    // `s` padded with spaces to `width` bytes (std::setw semantics)
+    void pad_left(std::string_view s, size_t width);
+    void pad_right(std::string_view s, size_t width);
+
+    size_t size() const { return buf_.size(); }
+    // Screen row (1-based) the next output lands on, for a frame that starts
+    // at the top-left corner (after clearing) and has no wrapped lines
+    int row() const;
+    // Write the frame to stdout in one go and start the next one; the buffer
+    // keeps its capacity. Pending std::cout output is flushed first so the
+    // two never interleave.
+    bool flush();
+
+private:
+    std::string buf_;
+};
+
+// The frame buffer for the interactive screen
+Writer& screen();
+
+} // namespace frame
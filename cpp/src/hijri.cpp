@@ -1,71 +1,265 @@
 #include "hijri.hpp"
 #include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <fstream>
-#include <sstream>
+#include <iterator>
 #include <vector>
 #include <ctime>
-#include <cstring>
 
 namespace hijri {
 
-struct MonthStart { int hy; int hm; int gy; int gm; int gd; };
-static std::vector<MonthStart> g_starts;
+// Accessed only through std::atomic_load/atomic_store; a replaced table is
+// freed when the last reader drops its reference
+static std::shared_ptr<const Table> g_current;
 
-static bool less_ms(const MonthStart& a, const MonthStart& b){
-    if (a.gy != b.gy) return a.gy < b.gy;
-    if (a.gm != b.gm) return a.gm < b.gm;
-    return a.gd < b.gd;
+std::shared_ptr<const Table> Table::from_csv(const std::filesystem::path& csv){
+    std::ifstream in(csv, std::ios::binary);
+    if (!in) return nullptr;
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return from_text(text);
 }
 
-bool load_umm_al_qura(const std::filesystem::path& dataDir){
-    g_starts.clear();
-    std::filesystem::path csv = dataDir / "hijri" / "umm_al_qura_month_starts.csv";
-    std::ifstream in(csv);
-    if (!in) return false;
-    std::string line; bool header = true;
-    while (std::getline(in, line)){
+// Largest accepted distance (days) between a row and the tabular month start
+static constexpr long kMaxRowDeviation = 2;
+
+// Integer field with surrounding blanks (and a CR) ignored; false if not a number
+static bool parse_int(std::string_view f, int& out){
+    while (!f.empty() && (f.front()==' ' || f.front()=='\t')) f.remove_prefix(1);
+    while (!f.empty() && (f.back()==' ' || f.back()=='\t' || f.back()=='\r')) f.remove_suffix(1);
+    auto r = std::from_chars(f.data(), f.data() + f.size(), out);
+    return r.ec == std::errc() && r.ptr == f.data() + f.size();
+}
+
+std::shared_ptr<const Table> Table::from_text(std::string_view text){
+    auto t = std::make_shared<Table>();
+    bool header = true;
+    while (!text.empty()){
+        size_t nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
         if (header){ header=false; continue; }
-        if (line.empty()) continue;
-        std::stringstream ss(line);
-        std::string hy,hm,gy,gm,gd;
-        if (!std::getline(ss, hy, ',')) continue;
-        std::getline(ss, hm, ',');
-        std::getline(ss, gy, ',');
-        std::getline(ss, gm, ',');
-        std::getline(ss, gd, ',');
-        MonthStart ms; ms.hy=0; ms.hm=0; ms.gy=0; ms.gm=0; ms.gd=0;
-        try{
-            ms.hy = std::stoi(hy); ms.hm = std::stoi(hm);
-            ms.gy = std::stoi(gy); ms.gm = std::stoi(gm); ms.gd = std::stoi(gd);
-        } catch(...){ continue; }
-        g_starts.push_back(ms);
+        if (line.empty() || line == "\r") continue;
+        int v[5];
+        int n = 0;
+        while (n < 5){
+            size_t comma = line.find(',');
+            if (!parse_int(line.substr(0, comma), v[n])) break;
+            ++n;
+            if (comma == std::string_view::npos) break;
+            line.remove_prefix(comma + 1);
+        }
+        if (n < 5) continue;
+        MonthStart ms;
+        ms.hy = v[0]; ms.hm = v[1];
+        ms.days = days_from_civil(v[2], v[3], v[4]);
+        // Observed calendars stay within a day or two of the tabular one; a row
+        // further off is a typo (wrong year or month) and would shift every date
+        HijriDate first; first.year = ms.hy; first.month = ms.hm; first.day = 1;
+        long dev = ms.days - tabular::days_from_hijri(first);
+        if (ms.hm < 1 || ms.hm > 12 || dev > kMaxRowDeviation || dev < -kMaxRowDeviation){
+            std::fprintf(stderr, "Hijri table: ignoring %d-%02d starting %04d-%02d-%02d (%ld days from the tabular calendar)\n",
+                         v[0], v[1], v[2], v[3], v[4], dev);
+            continue;
+        }
+        t->starts_.push_back(ms);
     }
-    std::sort(g_starts.begin(), g_starts.end(), less_ms);
-    return !g_starts.empty();
+    if (t->starts_.empty()) return nullptr;
+    std::sort(t->starts_.begin(), t->starts_.end(), [](const MonthStart& a, const MonthStart& b){ return a.days < b.days; });
+    // A month listed twice would break the (hy, hm) order; keep its first start
+    t->starts_.erase(std::unique(t->starts_.begin(), t->starts_.end(),
+                                 [](const MonthStart& a, const MonthStart& b){ return a.hy == b.hy && a.hm == b.hm; }),
+                     t->starts_.end());
+    return t;
+}
+
+// Index of the table row for Hijri month (hy, hm), or -1. Rows sorted by day
+// are also in (hy, hm) order, since from_text keeps only rows near the tabular
+// calendar, so a binary search works.
+long Table::find_month(int hy, int hm) const {
+    const long key = hy * 12L + hm;
+    auto it = std::lower_bound(starts_.begin(), starts_.end(), key,
+                               [](const MonthStart& s, long k){ return s.hy * 12L + s.hm < k; });
+    if (it == starts_.end() || it->hy != hy || it->hm != hm) return -1;
+    return (long)(it - starts_.begin());
+}
+
+// Length of the month at row i; 0 when the next start is unknown
+int Table::length_at(size_t i) const {
+    if (i+1 >= starts_.size()) return 0;
+    long n = starts_[i+1].days - starts_[i].days;
+    return (n == 29 || n == 30) ? (int)n : 0;
+}
+
+std::optional<HijriDate> Table::to_hijri(const GregorianDate& g) const {
+    long days = days_from_civil(g.year, g.month, g.day);
+    auto it = std::upper_bound(starts_.begin(), starts_.end(), days,
+                               [](long d, const MonthStart& s){ return d < s.days; });
+    if (it == starts_.begin()) return std::nullopt;
+    size_t i = (size_t)(it - starts_.begin()) - 1;
+    long delta = days - starts_[i].days;
+    int len = length_at(i);
+    // Past the last row the month length is unknown; allow at most 30 days
+    if (delta >= (len ? len : 30)) return std::nullopt;
+    HijriDate h; h.year = starts_[i].hy; h.month = starts_[i].hm; h.day = (int)delta + 1;
+    return h;
+}
+
+int Table::month_length(int hy, int hm) const {
+    long i = find_month(hy, hm);
+    return i < 0 ? 0 : length_at((size_t)i);
+}
+
+std::optional<GregorianDate> Table::to_gregorian(const HijriDate& h) const {
+    long i = find_month(h.year, h.month);
+    if (i < 0 || h.day < 1) return std::nullopt;
+    int len = length_at((size_t)i);
+    if (h.day > (len ? len : 30)) return std::nullopt;
+    return civil_from_days(starts_[(size_t)i].days + h.day - 1);
+}
+
+std::vector<DayPair> Table::month_grid(int hy, int hm) const {
+    std::vector<DayPair> out;
+    long i = find_month(hy, hm);
+    if (i < 0) return out;
+    int len = length_at((size_t)i);
+    if (!len) return out;
+    out.reserve((size_t)len);
+    long d0 = starts_[(size_t)i].days;
+    for (int d=1; d<=len; ++d){
+        DayPair p; p.hijri.year = hy; p.hijri.month = hm; p.hijri.day = d;
+        p.greg = civil_from_days(d0 + d - 1);
+        out.push_back(p);
+    }
+    return out;
+}
+
+std::vector<DayPair> Table::range(const HijriDate& first, const HijriDate& last) const {
+    std::vector<DayPair> out;
+    auto g0 = to_gregorian(first);
+    auto g1 = to_gregorian(last);
+    if (!g0 || !g1) return out;
+    long d0 = days_from_civil(g0->year, g0->month, g0->day);
+    long d1 = days_from_civil(g1->year, g1->month, g1->day);
+    if (d1 <= d0) return out;
+    out.reserve((size_t)(d1 - d0));
+    // Walk rows in step with the day counter; one lookup for the first day only
+    size_t i = (size_t)find_month(first.year, first.month);
+    for (long d=d0; d<d1; ++d){
+        while (i+1 < starts_.size() && starts_[i+1].days <= d) ++i;
+        DayPair p;
+        p.hijri.year = starts_[i].hy; p.hijri.month = starts_[i].hm; p.hijri.day = (int)(d - starts_[i].days) + 1;
+        p.greg = civil_from_days(d);
+        out.push_back(p);
+    }
+    return out;
+}
+
+DayPair Table::row(size_t i) const {
+    DayPair p;
+    p.hijri.year = starts_[i].hy; p.hijri.month = starts_[i].hm; p.hijri.day = 1;
+    p.greg = civil_from_days(starts_[i].days);
+    return p;
+}
+
+std::shared_ptr<const Table> current(){
+    return std::atomic_load(&g_current);
+}
+
+void publish(std::shared_ptr<const Table> table){
+    if (!table) return;
+    std::atomic_store(&g_current, std::move(table));
 }
 
-static int cmp_gdate(int y,int m,int d, const std::tm& t){
-    if (y != (t.tm_year+1900)) return (y < (t.tm_year+1900)) ? -1 : 1;
-    if (m != (t.tm_mon+1)) return (m < (t.tm_mon+1)) ? -1 : 1;
-    if (d != t.tm_mday) return (d < t.tm_mday) ? -1 : 1;
-    return 0;
+bool load_umm_al_qura(const std::filesystem::path& dataDir){
+    auto t = Table::from_csv(dataDir / "hijri" / "umm_al_qura_month_starts.csv");
+    if (!t) return false;
+    publish(std::move(t));
+    return true;
+}
+
+std::future<bool> load_umm_al_qura_async(const std::filesystem::path& dataDir){
+    return std::async(std::launch::async, [dataDir](){ return load_umm_al_qura(dataDir); });
+}
+
+std::optional<HijriDate> hijri_for_gregorian(const GregorianDate& g){
+    auto t = current();
+    return t ? t->to_hijri(g) : std::nullopt;
 }
 
 std::optional<HijriDate> hijri_for_date(const std::tm& localDate){
-    if (g_starts.empty()) return std::nullopt;
-    const MonthStart* last = nullptr;
-    for (size_t i=0;i<g_starts.size();++i){
-        const MonthStart& s = g_starts[i];
-        if (cmp_gdate(s.gy, s.gm, s.gd, localDate) <= 0) last = &s; else break;
+    GregorianDate g; g.year = localDate.tm_year + 1900; g.month = localDate.tm_mon + 1; g.day = localDate.tm_mday;
+    return hijri_for_gregorian(g);
+}
+
+std::optional<GregorianDate> gregorian_for_hijri(const HijriDate& h){
+    auto t = current();
+    return t ? t->to_gregorian(h) : std::nullopt;
+}
+
+int month_length(int hy, int hm){
+    auto t = current();
+    return t ? t->month_length(hy, hm) : 0;
+}
+
+std::vector<DayPair> month_grid(int hy, int hm){
+    auto t = current();
+    return t ? t->month_grid(hy, hm) : std::vector<DayPair>{};
+}
+
+std::vector<DayPair> hijri_range(const HijriDate& first, const HijriDate& last){
+    auto t = current();
+    return t ? t->range(first, last) : std::vector<DayPair>{};
+}
+
+HijriDate hijri_for_gregorian_any(const GregorianDate& g, bool* fromTable){
+    auto h = hijri_for_gregorian(g);
+    if (fromTable) *fromTable = h.has_value();
+    return h ? *h : tabular::from_gregorian(g);
+}
+
+static std::vector<DayPair> tabular_range(long d0, long d1){
+    std::vector<DayPair> out;
+    if (d1 <= d0) return out;
+    out.reserve((size_t)(d1 - d0));
+    HijriDate h = tabular::hijri_from_days(d0);
+    for (long d=d0; d<d1; ++d){
+        DayPair p; p.hijri = h; p.greg = civil_from_days(d);
+        out.push_back(p);
+        if (++h.day > tabular::month_length(h.year, h.month)){
+            h.day = 1;
+            if (++h.month > 12){ h.month = 1; ++h.year; }
+        }
     }
-    if (!last) return std::nullopt;
-    std::tm st; ::memset(&st, 0, sizeof(st)); st.tm_year = last->gy - 1900; st.tm_mon = last->gm - 1; st.tm_mday = last->gd; st.tm_isdst=-1;
-    time_t t0 = mktime(&st);
-    std::tm dt = localDate; dt.tm_isdst=-1; time_t t1 = mktime(&dt);
-    if (t0 == (time_t)-1 || t1 == (time_t)-1) return std::nullopt;
-    int delta = (int)((t1 - t0) / 86400);
-    HijriDate h; h.year = last->hy; h.month = last->hm; h.day = delta + 1; if (h.day < 1) h.day = 1; if (h.day > 30) h.day = 30;
-    return h;
+    return out;
+}
+
+std::vector<DayPair> month_grid_any(int hy, int hm, bool* fromTable){
+    std::vector<DayPair> out = month_grid(hy, hm);
+    if (fromTable) *fromTable = !out.empty();
+    if (!out.empty()) return out;
+    HijriDate first; first.year = hy; first.month = hm; first.day = 1;
+    long d0 = tabular::days_from_hijri(first);
+    return tabular_range(d0, d0 + tabular::month_length(hy, hm));
+}
+
+std::vector<DayPair> hijri_range_any(const HijriDate& first, const HijriDate& last, bool* fromTable){
+    std::vector<DayPair> out = hijri_range(first, last);
+    if (fromTable) *fromTable = !out.empty();
+    if (!out.empty()) return out;
+    return tabular_range(tabular::days_from_hijri(first), tabular::days_from_hijri(last));
+}
+
+int max_tabular_deviation(tabular::LeapPattern p, tabular::Epoch e){
+    auto t = current();
+    if (!t) return 0;
+    long worst = 0;
+    for (size_t i=0;i<t->rows();++i){
+        DayPair r = t->row(i);
+        long diff = days_from_civil(r.greg.year, r.greg.month, r.greg.day) - tabular::days_from_hijri(r.hijri, p, e);
+        worst = std::max(worst, diff < 0 ? -diff : diff);
+    }
+    return (int)worst;
 }
 
 const char* month_name_en(int m){
@@ -77,4 +271,11 @@ const char* month_name_ar(int m){
     if (m < 1 || m > 12) return ""; return N[m-1];
 }
 
+std::string display_date(const GregorianDate& g, bool arabic){
+    HijriDate hd = hijri_for_gregorian_any(g);
+    const char* mname = arabic ? month_name_ar(hd.month) : month_name_en(hd.month);
+    char buf[128]; std::snprintf(buf, sizeof(buf), "%d %s %d AH", hd.day, mname, hd.year);
+    return buf;
+}
+
 } // namespace hijri
@@ -1,7 +1,10 @@
 #pragma once
 #include <optional>
 #include <string>
+#include <string_view>
 #include <filesystem>
+#include <future>
+#include <memory>
 #include <ctime>
 #include <vector>
 
@@ -13,16 +16,220 @@ struct HijriDate {
     int day{};    // 1..30
 };
 
-// Load Umm al-Qura month starts from CSV file at dataDir/hijri/umm_al_qura_month_starts.csv
-// CSV format (with header): hijri_year,hijri_month,gregorian_yyyy,gregorian_mm,gregorian_dd
+struct GregorianDate {
+    int year{};   // CE
+    int month{};  // 1..12
+    int day{};    // 1..31
+};
+
+// One day of a Hijri calendar range: both sides of the conversion
+struct DayPair {
+    HijriDate hijri;
+    GregorianDate greg;
+};
+
+// Immutable Umm al-Qura table. Built once (on any thread), never modified after,
+// so any number of threads may convert through the same instance without locking.
+class Table {
+public:
+    // Parse a CSV file (header: hijri_year,hijri_month,gregorian_yyyy,gregorian_mm,gregorian_dd).
+    // Returns nullptr if the file is missing or has no usable rows.
+    static std::shared_ptr<const Table> from_csv(const std::filesystem::path& csv);
+    // The same format from text in memory
+    static std::shared_ptr<const Table> from_text(std::string_view text);
+
+    std::optional<HijriDate> to_hijri(const GregorianDate& g) const;
+    std::optional<GregorianDate> to_gregorian(const HijriDate& h) const;
+    int month_length(int hy, int hm) const;
+    std::vector<DayPair> month_grid(int hy, int hm) const;
+    std::vector<DayPair> range(const HijriDate& first, const HijriDate& last) const;
+
+    // Month-start rows in date order (day 1 of each Hijri month)
+    size_t rows() const { return starts_.size(); }
+    DayPair row(size_t i) const;
+
+private:
+    struct MonthStart { int hy; int hm; long days; };
+    std::vector<MonthStart> starts_; // sorted by days
+    long find_month(int hy, int hm) const;
+    int length_at(size_t i) const;
+};
+
+// The table published for the whole process, or nullptr before the first load.
+// The reference keeps the table alive even if a newer one is published while it
+// is in use; a replaced table is freed once no caller holds it.
+std::shared_ptr<const Table> current();
+
+// Atomically replace the process-wide table. Readers see either the old or the new one.
+void publish(std::shared_ptr<const Table> table);
+
+// Build the table from dataDir/hijri/umm_al_qura_month_starts.csv and publish it.
 bool load_umm_al_qura(const std::filesystem::path& dataDir);
 
+// Same, but parses on a background thread; the published table switches when it is ready.
+std::future<bool> load_umm_al_qura_async(const std::filesystem::path& dataDir);
+
+// Convenience wrappers over current(); std::nullopt / empty when nothing is published.
 // Convert a local calendar date (struct tm) to Hijri using the loaded table.
 // Returns std::nullopt if table not loaded or date out of range.
 std::optional<HijriDate> hijri_for_date(const std::tm& localDate);
+std::optional<HijriDate> hijri_for_gregorian(const GregorianDate& g);
+
+// Convert a Hijri date back to the Gregorian calendar using the loaded table.
+// Returns std::nullopt if the month is not covered or the day exceeds its length.
+std::optional<GregorianDate> gregorian_for_hijri(const HijriDate& h);
+
+// Length (29 or 30) of a Hijri month, or 0 when the table does not bound it
+// (the month is missing, or it is the last row and the next start is unknown).
+int month_length(int hy, int hm);
+
+// All days of a Hijri month with their Gregorian dates, in order.
+// Empty if the month is not fully covered by the table.
+std::vector<DayPair> month_grid(int hy, int hm);
+
+// Consecutive days from `first` up to but excluding `last` (e.g. 1 Ramadan .. 1 Shawwal).
+// Walks day numbers once instead of converting every date; empty if either end is out of range.
+std::vector<DayPair> hijri_range(const HijriDate& first, const HijriDate& last);
+
+// Proleptic Gregorian <-> days since 1970-01-01 (integer only)
+constexpr long days_from_civil(int y, int m, int d){
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const long yoe = (long)y - era * 400;                                  // [0, 399]
+    const long doy = (153L * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;      // [0, 365]
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                // [0, 146096]
+    return era * 146097 + doe - 719468;
+}
+
+constexpr GregorianDate civil_from_days(long z){
+    z += 719468;
+    const long era = (z >= 0 ? z : z - 146096) / 146097;
+    const long doe = z - era * 146097;
+    const long yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    const long doy = doe - (365*yoe + yoe/4 - yoe/100);
+    const long mp = (5*doy + 2) / 153;
+    GregorianDate g;
+    g.day = (int)(doy - (153*mp + 2)/5 + 1);
+    g.month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    g.year = (int)(yoe + era * 400 + (g.month <= 2));
+    return g;
+}
+
+// Arithmetical (tabular) Islamic calendar: 30-year cycles of 10631 days with 11
+// leap years, odd months 30 days, even months 29, Dhul-Hijjah 30 in leap years.
+// Integer only and constexpr; used for dates the Umm al-Qura table does not cover.
+namespace tabular {
+
+// Which years of the 30-year cycle have 355 days
+enum class LeapPattern {
+    Kushyar,  // 2,5,7,10,13,15,18,21,24,26,29
+    Base16,   // 2,5,7,10,13,16,18,21,24,26,29 (the common "Kuwaiti" variant)
+    Fatimid,  // 2,5,8,10,13,16,19,21,24,27,29
+    Habash    // 2,5,8,11,13,16,19,21,24,27,30
+};
+
+// 1 Muharram 1 AH: 16 July 622 (Julian) for the civil epoch, a day earlier for the astronomical one
+enum class Epoch { Civil, Astronomical };
+
+constexpr long kCycleDays = 10631;
+
+// Bit (y-1) set when cycle year y (1..30) is a leap year
+constexpr unsigned long leap_mask(LeapPattern p){
+    switch (p){
+        case LeapPattern::Kushyar: return (1UL<<1)|(1UL<<4)|(1UL<<6)|(1UL<<9)|(1UL<<12)|(1UL<<14)|(1UL<<17)|(1UL<<20)|(1UL<<23)|(1UL<<25)|(1UL<<28);
+        case LeapPattern::Fatimid: return (1UL<<1)|(1UL<<4)|(1UL<<7)|(1UL<<9)|(1UL<<12)|(1UL<<15)|(1UL<<18)|(1UL<<20)|(1UL<<23)|(1UL<<26)|(1UL<<28);
+        case LeapPattern::Habash:  return (1UL<<1)|(1UL<<4)|(1UL<<7)|(1UL<<10)|(1UL<<12)|(1UL<<15)|(1UL<<18)|(1UL<<20)|(1UL<<23)|(1UL<<26)|(1UL<<29);
+        case LeapPattern::Base16:
+        default:                   return (1UL<<1)|(1UL<<4)|(1UL<<6)|(1UL<<9)|(1UL<<12)|(1UL<<15)|(1UL<<17)|(1UL<<20)|(1UL<<23)|(1UL<<25)|(1UL<<28);
+    }
+}
+
+constexpr long epoch_days(Epoch e){
+    // JDN 1948440 (civil) / 1948439 (astronomical) minus JDN 2440588 (1970-01-01)
+    return e == Epoch::Civil ? -492148L : -492149L;
+}
+
+// Floored division/modulo so years before 1 AH stay consistent
+constexpr long floor_div(long a, long b){ return a / b - ((a % b != 0) && ((a < 0) != (b < 0))); }
+constexpr long floor_mod(long a, long b){ return a - floor_div(a, b) * b; }
+
+constexpr bool is_leap(int hy, LeapPattern p = LeapPattern::Base16){
+    return (leap_mask(p) >> floor_mod(hy - 1, 30)) & 1UL;
+}
+
+constexpr int month_length(int hy, int hm, LeapPattern p = LeapPattern::Base16){
+    return (hm % 2 == 1 || (hm == 12 && is_leap(hy, p))) ? 30 : 29;
+}
+
+// Days from 1 Muharram of cycle year 1 to 1 Muharram of cycle year y (1..30)
+constexpr long days_before_cycle_year(int y, LeapPattern p){
+    long n = 354L * (y - 1);
+    unsigned long m = leap_mask(p);
+    for (int i = 0; i < y - 1; ++i) n += (m >> i) & 1UL;
+    return n;
+}
+
+// Hijri date -> days since 1970-01-01
+constexpr long days_from_hijri(const HijriDate& h, LeapPattern p = LeapPattern::Base16, Epoch e = Epoch::Civil){
+    long cycle = floor_div(h.year - 1, 30);
+    int y = (int)floor_mod(h.year - 1, 30) + 1;
+    long n = cycle * kCycleDays + days_before_cycle_year(y, p);
+    n += 29L * (h.month - 1) + h.month / 2;       // months alternate 30/29
+    return epoch_days(e) + n + h.day - 1;
+}
+
+// Days since 1970-01-01 -> Hijri date
+constexpr HijriDate hijri_from_days(long days, LeapPattern p = LeapPattern::Base16, Epoch e = Epoch::Civil){
+    long n = days - epoch_days(e);
+    long cycle = floor_div(n, kCycleDays);
+    long r = n - cycle * kCycleDays;             // [0, 10631)
+    unsigned long m = leap_mask(p);
+    int y = 1;
+    for (; y < 30; ++y){
+        long len = 354 + (long)((m >> (y - 1)) & 1UL);
+        if (r < len) break;
+        r -= len;
+    }
+    // r is the day of year [0, 354]; 59 days per pair of months
+    int month = (int)(r / 59) * 2 + 1;
+    long rem = r % 59;
+    if (rem >= 30){ ++month; rem -= 30; }
+    if (month > 12){ month = 12; rem = r - 325; } // day 355 of a leap year
+    HijriDate h;
+    h.year = (int)(cycle * 30 + y);
+    h.month = month;
+    h.day = (int)rem + 1;
+    return h;
+}
+
+constexpr HijriDate from_gregorian(const GregorianDate& g, LeapPattern p = LeapPattern::Base16, Epoch e = Epoch::Civil){
+    return hijri_from_days(days_from_civil(g.year, g.month, g.day), p, e);
+}
+
+constexpr GregorianDate to_gregorian(const HijriDate& h, LeapPattern p = LeapPattern::Base16, Epoch e = Epoch::Civil){
+    return civil_from_days(days_from_hijri(h, p, e));
+}
+
+} // namespace tabular
+
+// Umm al-Qura table when it covers the date, tabular (Base16, civil) otherwise.
+// `fromTable` reports which one answered.
+HijriDate hijri_for_gregorian_any(const GregorianDate& g, bool* fromTable = nullptr);
+
+// Month grid / range with the same fallback; the tabular calendar may differ
+// from Umm al-Qura by a day or two.
+std::vector<DayPair> month_grid_any(int hy, int hm, bool* fromTable = nullptr);
+std::vector<DayPair> hijri_range_any(const HijriDate& first, const HijriDate& last, bool* fromTable = nullptr);
+
+// Compare the published table's month starts with a tabular pattern.
+// Returns the largest absolute difference in days (0 when nothing is published).
+int max_tabular_deviation(tabular::LeapPattern p, tabular::Epoch e = tabular::Epoch::Civil);
 
 // Utility to format Hijri month names (English/Arabic)
 const char* month_name_en(int m);
 const char* month_name_ar(int m);
+// "7 Jumada I 1448 AH" (Arabic month name when `arabic`), with the fallback
+// of hijri_for_gregorian_any
+std::string display_date(const GregorianDate& g, bool arabic);
 
 } // namespace hijri
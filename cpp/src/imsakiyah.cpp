@@ -0,0 +1,149 @@
+#include "imsakiyah.hpp"
+#include "hijri.hpp"
+#include "prayer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <thread>
+
+namespace imsakiyah {
+
+struct Day {
+    hijri::DayPair date;
+    prayer::SolarDay solar;
+    char iso[11];
+};
+
+static void append_json_string(std::string& out, const std::string& s){
+    out.push_back('"');
+    for (char c : s){
+        if (c=='"' || c=='\\'){ out.push_back('\\'); out.push_back(c); }
+        else if ((unsigned char)c < 0x20) out.push_back(' ');
+        else out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// RFC 4180 field: always quoted (names may contain commas), inner quotes doubled
+static void append_csv_field(std::string& out, const std::string& s){
+    out.push_back('"');
+    for (char c : s){
+        if (c=='"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+static std::string safe_file_name(const City& c){
+    std::string s = c.name + "_" + c.country;
+    for (char &ch : s){
+        if (!std::isalnum((unsigned char)ch) && ch!='-' && ch!='_' && (unsigned char)ch < 0x80) ch = '_';
+    }
+    return s;
+}
+
+// Render one city's whole month into `out` (CSV rows or one JSON line)
+static void render_city(const Options& opt, const City& c, const std::vector<Day>& days, std::string& out){
+    std::optional<double> tz = prayer::parse_tz_hours(c.tz);
+    if (opt.json){
+        out += "{\"city\":"; append_json_string(out, c.name);
+        out += ",\"country\":"; append_json_string(out, c.country);
+        out += ",\"days\":[";
+    }
+    bool first = true;
+    for (const Day& d : days){
+        auto pt = prayer::compute_prayer_times(d.solar, c.lat, c.lon, opt.method, opt.madhab, opt.highLatRule, tz);
+        if (!pt) continue;
+        std::string imsak = prayer::fmt_time(pt->fajr - opt.imsakMinutes/60.0, opt.use24h);
+        std::string fajr = prayer::fmt_time(pt->fajr, opt.use24h);
+        std::string sunrise = prayer::fmt_time(pt->sunrise, opt.use24h);
+        std::string dhuhr = prayer::fmt_time(pt->dhuhr, opt.use24h);
+        std::string asr = prayer::fmt_time(pt->asr, opt.use24h);
+        std::string maghrib = prayer::fmt_time(pt->maghrib, opt.use24h);
+        std::string isha = prayer::fmt_time(pt->isha, opt.use24h);
+        char hday[8]; std::snprintf(hday, sizeof(hday), "%d", d.date.hijri.day);
+        if (opt.json){
+            if (!first) out.push_back(',');
+            out += "{\"ramadan\":"; out += hday;
+            out += ",\"date\":\""; out += d.iso;
+            out += "\",\"imsak\":\""; out += imsak;
+            out += "\",\"fajr\":\""; out += fajr;
+            out += "\",\"sunrise\":\""; out += sunrise;
+            out += "\",\"dhuhr\":\""; out += dhuhr;
+            out += "\",\"asr\":\""; out += asr;
+            out += "\",\"iftar\":\""; out += maghrib;
+            out += "\",\"isha\":\""; out += isha;
+            out += "\"}";
+        } else {
+            append_csv_field(out, c.name); out += ','; append_csv_field(out, c.country); out += ',';
+            out += hday; out += ','; out += d.iso; out += ',';
+            out += imsak; out += ','; out += fajr; out += ','; out += sunrise; out += ',';
+            out += dhuhr; out += ','; out += asr; out += ','; out += maghrib; out += ','; out += isha; out += '\n';
+        }
+        first = false;
+    }
+    if (opt.json) out += "]}\n";
+}
+
+static const char* csv_header(){
+    return "city,country,ramadan,date,imsak,fajr,sunrise,dhuhr,asr,iftar,isha\n";
+}
+
+int generate(const Options& opt, const std::vector<City>& cities, std::ostream& out){
+    hijri::HijriDate first; first.year = opt.year; first.month = 9; first.day = 1;
+    hijri::HijriDate last; last.year = opt.year; last.month = 10; last.day = 1;
+    bool fromTable = false;
+    std::vector<hijri::DayPair> range = hijri::hijri_range_any(first, last, &fromTable);
+    if (range.empty()) return -1;
+    if (!fromTable && !opt.allowTabular) return -1;
+
+    // Per-day data shared by every city: date strings and solar parameters
+    std::vector<Day> days(range.size());
+    for (size_t i=0;i<range.size();++i){
+        Day& d = days[i];
+        d.date = range[i];
+        std::tm tm{}; tm.tm_year = d.date.greg.year - 1900; tm.tm_mon = d.date.greg.month - 1; tm.tm_mday = d.date.greg.day;
+        d.solar = prayer::solar_day(tm);
+        std::snprintf(d.iso, sizeof(d.iso), "%04d-%02d-%02d", d.date.greg.year, d.date.greg.month, d.date.greg.day);
+    }
+
+    std::vector<std::string> results(cities.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&](){
+        for (size_t i = next++; i < cities.size(); i = next++){
+            results[i].reserve(days.size() * 96);
+            render_city(opt, cities[i], days, results[i]);
+        }
+    };
+    unsigned n = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    n = (unsigned)std::min<size_t>(n, cities.size());
+    std::vector<std::thread> pool;
+    for (unsigned t=1; t<n; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool) th.join();
+
+    int written = 0;
+    if (!opt.outDir.empty()){
+        std::error_code ec; std::filesystem::create_directories(opt.outDir, ec);
+        for (size_t i=0;i<cities.size();++i){
+            std::filesystem::path p = opt.outDir / (safe_file_name(cities[i]) + (opt.json ? ".json" : ".csv"));
+            std::ofstream f(p, std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!f) continue;
+            if (!opt.json) f << csv_header();
+            f.write(results[i].data(), (std::streamsize)results[i].size());
+            ++written;
+        }
+    } else {
+        if (!opt.json) out << csv_header();
+        for (const auto &r : results){ out.write(r.data(), (std::streamsize)r.size()); ++written; }
+    }
+    return written;
+}
+
+} // namespace imsakiyah
@@ -0,0 +1,31 @@
+#pragma once
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "ui.hpp"
+
+namespace imsakiyah {
+
+struct Options {
+    int year = 0;                 // Hijri year; Ramadan of this year is generated
+    int imsakMinutes = 10;        // Imsak = Fajr minus this many minutes
+    bool json = false;            // JSON Lines (one object per city) instead of CSV
+    bool use24h = true;
+    std::string method = "umm_al_qura";
+    std::string madhab = "shafi";
+    std::string highLatRule = "middle_of_the_night";
+    std::filesystem::path outDir; // if set, one file per city; otherwise stream to `out`
+    unsigned threads = 0;         // 0 = hardware concurrency
+    bool allowTabular = false;    // fall back to the tabular calendar outside the Umm al-Qura table
+};
+
+// Generate the Ramadan timetable for every city. The date range comes from the
+// loaded Hijri table (1 Ramadan up to 1 Shawwal); solar parameters are computed
+// once per day and the cities are split across worker threads. Output keeps the
+// order of `cities`. Returns the number of cities written, or -1 if the year's
+// Ramadan is not covered by the Hijri table (and allowTabular is off).
+int generate(const Options& opt, const std::vector<City>& cities, std::ostream& out);
+
+} // namespace imsakiyah
@@ -2,21 +2,33 @@
 #include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <csignal>
 #include <vector>
 #include <cstdio>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <optional>
 #include <sstream>
 #include <string>
-#include <unordered_map>
 
 #include "platform.hpp"
 #include "ui.hpp"
 #include "hijri.hpp"
+#include "prayer.hpp"
+#include "imsakiyah.hpp"
+#include "zoneclock.hpp"
+#include "citydb.hpp"
+#include "settings.hpp"
+#include "resources.hpp"
+#include "oneshot.hpp"
+#include "daycache.hpp"
+#include "frame.hpp"
+#include "trace.hpp"
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -40,53 +52,14 @@ static void enable_windows_utf8_and_ansi(){
 
 namespace fs = std::filesystem;
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-// Very tiny, permissive TOML-ish reader for flat key=value (string/number/bool) pairs.
-// It's not a full TOML parser, but enough to detect config path and read some prefs.
-static std::unordered_map<std::string, std::string> read_simple_kv(const fs::path &p) {
-    std::unordered_map<std::string, std::string> kv;
-    std::ifstream in(p);
-    if (!in) return kv;
-    std::string line;
-    while (std::getline(in, line)) {
-        // Strip comments
-        auto hash = line.find('#');
-        if (hash != std::string::npos) line = line.substr(0, hash);
-        // Trim
-        auto ltrim = [](std::string &s){ s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch){ return !std::isspace(ch); })); };
-        auto rtrim = [](std::string &s){ s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch){ return !std::isspace(ch); }).base(), s.end()); };
-        ltrim(line); rtrim(line);
-        if (line.empty() || line[0]=='[') continue; // ignore sections
-        auto eq = line.find('=');
-        if (eq == std::string::npos) continue;
-        std::string key = line.substr(0, eq);
-        std::string val = line.substr(eq+1);
-        ltrim(key); rtrim(key); ltrim(val); rtrim(val);
-        if (!val.empty() && (val.front()=='"' || val.front()=='\'')) {
-            if (val.size()>=2 && val.back()==val.front()) {
-                val = val.substr(1, val.size()-2);
-            }
-        }
-        kv[key] = val;
-    }
-    return kv;
-}
+// Raw coordinates within this distance of a known city take its name and timezone
+static constexpr double kSnapRadiusKm = 50.0;
 
 static std::string now_local_iso() {
-    using namespace std::chrono;
-    auto t = system_clock::to_time_t(system_clock::now());
-    std::tm tm{};
-#if defined(_WIN32)
-    localtime_s(&tm, &t);
-#else
-    localtime_r(&t, &tm);
-#endif
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+    std::tm tm = zoneclock::ui_clock().local_now();
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+    return buf;
 }
 
 #if defined(_WIN32)
@@ -137,39 +110,10 @@ static std::optional<std::tuple<double,double,std::string,std::string,std::strin
 }
 #endif
 
-// Very simple Hijri approximation (Umm al-Qura-like) for display only.
-// For production-grade accuracy, replace with a true Umm al-Qura table-based conversion.
-static std::string approx_hijri_date(const std::tm &lt){
-    // Algorithm: Kuwaiti algorithm-style rough approximation
-    int y = lt.tm_year + 1900;
-    int m = lt.tm_mon + 1;
-    int d = lt.tm_mday;
-    // Julian Day Number (approx Gregorian to JDN)
-    int a = (14 - m)/12;
-    int y2 = y + 4800 - a;
-    int m2 = m + 12*a - 3;
-    long jdn = d + (153*m2 + 2)/5 + 365L*y2 + y2/4 - y2/100 + y2/400 - 32045;
-    // Islamic date calculation (Tabular, 30-year cycle)
-    long l = jdn - 1948439; // days since 1 Muharram 1 AH (approx)
-    long hcycles = l / 10631; // 30-year cycles
-    l %= 10631;
-    long ycycle = (l - 0.1335) / 354.36667; // close fit
-    if (ycycle < 0) ycycle = 0;
-    long hy = 1 + (long)ycycle + 30*hcycles;
-    long doy = l - (long)(std::floor((ycycle)*354.36667 + 0.5));
-    if (doy < 0) doy = 0;
-    // Months: alternates 30/29 roughly; 12 months per year
-    int hm = 1; int hd = (int)doy + 1; // start counting day 1
-    static const int ml[12] = {30,29,30,29,30,29,30,29,30,29,30,29};
-    for (int i=0;i<12;i++){
-        if (hd > ml[i]){ hd -= ml[i]; hm++; }
-        else break;
-    }
-    const char* mnames[12] = {"Muharram","Safar","Rabi' I","Rabi' II","Jumada I","Jumada II","Rajab","Sha'ban","Ramadan","Shawwal","Dhul-Qa'dah","Dhul-Hijjah"};
-    hm = std::min(std::max(hm,1),12);
-    char buf[128];
-    std::snprintf(buf, sizeof(buf), "%d %s %ld AH", hd, mnames[hm-1], hy);
-    return std::string(buf);
+// Hijri date for display: Umm al-Qura table when it covers the date, tabular calendar otherwise
+static std::string hijri_display(const std::tm &lt, bool ar){
+    hijri::GregorianDate g; g.year = lt.tm_year + 1900; g.month = lt.tm_mon + 1; g.day = lt.tm_mday;
+    return hijri::display_date(g, ar);
 }
 
 // Add or subtract whole days from a time_t, returning local tm
@@ -190,37 +134,17 @@ static std::tm add_days_local(std::tm base, int days){
 }
 
 // Simple theming: none|light|dark|auto (auto=use dark) + optional 256-color fg/bg
-struct Theme { bool color = true; bool dark = true; int fg = -1; int bg = -1; };
-static Theme resolve_theme(const std::string &colors){
-    std::string c = colors; std::string x; x.resize(c.size());
-    std::transform(c.begin(), c.end(), x.begin(), [](unsigned char ch){ return (char)std::tolower(ch); });
-    if (x == "none" || x == "off") return Theme{false, true};
-    if (x == "light") return Theme{true, false};
-    if (x == "dark") return Theme{true, true};
+struct Theme { bool color = true; bool dark = true; int fg = -1; int bg = -1; frame::Palette esc = {}; };
+static Theme resolve_theme(settings::ColorMode colors){
+    switch (colors){
+        case settings::ColorMode::None: return Theme{false, true};
+        case settings::ColorMode::Light: return Theme{true, false};
+        case settings::ColorMode::Dark: return Theme{true, true};
+        case settings::ColorMode::Auto: break;
+    }
     // auto default to dark
     return Theme{true, true};
 }
-static std::string cstr(const Theme &t, const char* code){ return t.color ? std::string(code) : std::string(""); }
-static std::string creset(const Theme &t){ return t.color ? std::string("\x1b[0m") : std::string(""); }
-static std::string cbold(const Theme &t){ return t.color ? std::string("\x1b[1m") : std::string(""); }
-static std::string cdim(const Theme &t){ return t.color ? std::string("\x1b[2m") : std::string(""); }
-static std::string cfg(const Theme &t, int idx){
-    if (!t.color) return "";
-    char buf[16]; std::snprintf(buf, sizeof(buf), "\x1b[38;5;%dm", idx);
-    return std::string(buf);
-}
-static std::string cbg(const Theme &t, int idx){
-    if (!t.color) return "";
-    char buf[16]; std::snprintf(buf, sizeof(buf), "\x1b[48;5;%dm", idx);
-    return std::string(buf);
-}
-static std::string creset_bg(const Theme &t){
-    if (!t.color) return "";
-    std::string s = "\x1b[0m";
-    if (t.bg>=0) s += cbg(t, t.bg);
-    if (t.fg>=0) s += cfg(t, t.fg);
-    return s;
-}
 
 // Bidirectional text helpers (Arabic):
 // Use Right-to-Left Embedding (U+202B) and Pop Directional Formatting (U+202C)
@@ -244,258 +168,58 @@ static int parse_color_index(const std::string &nameOrIndex){
     if (s=="dark") return 235; if (s=="light") return 255;
     return -1;
 }
-static Theme build_theme(const std::string &colors, const std::string &fgS, const std::string &bgS){
+static Theme build_theme(settings::ColorMode colors, const std::string &fgS, const std::string &bgS){
     Theme t = resolve_theme(colors);
     t.fg = parse_color_index(fgS);
     t.bg = parse_color_index(bgS);
     // auto contrast if fg not set but bg is
     if (t.bg>=0 && t.fg<0){ t.fg = (t.bg<100? 231 : 16); }
+    t.esc = frame::make_palette(t.color, t.fg, t.bg);
     return t;
 }
-static void clear_screen(){ std::cout << "\x1b[2J\x1b[H"; }
-static void apply_theme_colors(const Theme &t){
-    if (!t.color) return;
-    if (t.bg>=0) std::cout << cbg(t, t.bg);
-    if (t.fg>=0) std::cout << cfg(t, t.fg);
-}
-
-// Math helpers
-static inline double deg2rad(double d){ return d * M_PI / 180.0; }
-static inline double rad2deg(double r){ return r * 180.0 / M_PI; }
-static inline double clamp(double v, double lo, double hi){ return std::max(lo, std::min(hi, v)); }
+static void clear_screen(frame::Writer &w){ w << "\x1b[2J\x1b[H"; }
+static void apply_theme_colors(frame::Writer &w, const Theme &t){ w << t.esc.base; }
 
 // Draw a boxed table with Unicode line art
-static void draw_boxed_table(const Theme& theme,
+static void draw_boxed_table(frame::Writer& w, const Theme& theme,
                              const std::vector<std::string>& leftCol,
                              const std::vector<std::string>& rightCol,
                              int highlightRow /*-1 = none*/, bool rtlNames /*=false*/ = false){
+    const frame::Palette &e = theme.esc;
     size_t n = std::min(leftCol.size(), rightCol.size());
     size_t lw = 0, rw = 0;
     for (size_t i=0;i<n;i++){ lw = std::max(lw, leftCol[i].size()); rw = std::max(rw, rightCol[i].size()); }
     lw = std::min<size_t>(lw, 16); // cap a bit
     rw = std::max<size_t>(rw, 5);
-    auto rep_s = [](const std::string& piece, size_t count){ std::string s; s.reserve(piece.size()*count); for(size_t i=0;i<count;++i) s += piece; return s; };
-    const std::string h = "─"; // UTF-8 horizontal line
-    std::string top = std::string("\x1b[0m\x1b[90m") + "┌" + rep_s(h, lw+2) + "┬" + rep_s(h, rw+2) + "┐" + creset_bg(theme);
-    std::string mid = std::string("\x1b[0m\x1b[90m") + "├" + rep_s(h, lw+2) + "┼" + rep_s(h, rw+2) + "┤" + creset_bg(theme);
-    std::string bot = std::string("\x1b[0m\x1b[90m") + "└" + rep_s(h, lw+2) + "┴" + rep_s(h, rw+2) + "┘" + creset_bg(theme);
-    std::cout << top << "\n";
+    auto rule = [&](const char* l, const char* m, const char* r){
+        w << e.border << l;
+        for (size_t i=0;i<lw+2;++i) w << "─";
+        w << m;
+        for (size_t i=0;i<rw+2;++i) w << "─";
+        w << r << e.resetBase << "\n";
+    };
+    // Names are right-aligned for Arabic; times follow the same side
+    auto cell = [&](const std::string &s, size_t width){ if (rtlNames) w.pad_left(s, width); else w.pad_right(s, width); };
+    const std::string_view sep = " \x1b[90m│\x1b[0m ";
+    rule("┌", "┬", "┐");
     // Header row (localized)
-    {
-        std::string l = rtlNames ? "الصلاة" : "Prayer"; std::string r = rtlNames ? "الوقت" : "Time";
-        if (rtlNames){
-            std::cout << "\x1b[90m│\x1b[0m " << cbold(theme) << cfg(theme, 45) << std::right << std::setw((int)lw) << l << creset_bg(theme)
-                      << " \x1b[90m│\x1b[0m " << cbold(theme) << cfg(theme, 45) << std::setw((int)rw) << r << creset_bg(theme)
-                      << " \x1b[90m│\x1b[0m\n";
-        } else {
-            std::cout << "\x1b[90m│\x1b[0m " << cbold(theme) << cfg(theme, 45) << std::left << std::setw((int)lw) << l << creset_bg(theme)
-                      << " \x1b[90m│\x1b[0m " << cbold(theme) << cfg(theme, 45) << std::setw((int)rw) << r << creset_bg(theme)
-                      << " \x1b[90m│\x1b[0m\n";
-        }
-    }
-    std::cout << mid << "\n";
+    w << "\x1b[90m│\x1b[0m " << e.accent; cell(rtlNames ? "الصلاة" : "Prayer", lw);
+    w << e.resetBase << sep << e.accent; cell(rtlNames ? "الوقت" : "Time", rw);
+    w << e.resetBase << " \x1b[90m│\x1b[0m\n";
+    rule("├", "┼", "┤");
     for (size_t i=0;i<n;i++){
         bool hl = ((int)i == highlightRow);
-        std::string pre = hl ? (cbold(theme) + cfg(theme, 82)) : std::string(""); // green highlight
-        std::string suf = hl ? creset(theme) : std::string("");
-        if (rtlNames){
-            std::cout << "\x1b[90m│\x1b[0m "
-                      << pre << std::right << std::setw((int)lw) << leftCol[i] << suf
-                      << " \x1b[90m│\x1b[0m "
-                      << pre << std::setw((int)rw) << rightCol[i] << suf
-                      << " \x1b[90m│\x1b[0m\n";
-        } else {
-            std::cout << "\x1b[90m│\x1b[0m "
-                      << pre << std::left << std::setw((int)lw) << leftCol[i] << suf
-                      << " \x1b[90m│\x1b[0m "
-                      << pre << std::setw((int)rw) << rightCol[i] << suf
-                      << " \x1b[90m│\x1b[0m\n";
-        }
-        if (i+1==n) break;
-    }
-    std::cout << bot << "\n";
-}
-
-static void draw_progress_bar(const Theme& theme, double fraction, int width=30){
-    fraction = std::max(0.0, std::min(1.0, fraction));
-    int filled = (int)std::round(fraction * width);
-    std::string bar = "[";
-    for (int i=0;i<width;i++){
-        if (i < filled) bar += "#"; else bar += "-";
+        std::string_view pre = hl ? std::string_view(e.highlight) : std::string_view(); // green highlight
+        std::string_view suf = hl ? std::string_view(e.reset) : std::string_view();
+        w << "\x1b[90m│\x1b[0m " << pre; cell(leftCol[i], lw);
+        w << suf << sep << pre; cell(rightCol[i], rw);
+        w << suf << " \x1b[90m│\x1b[0m\n";
     }
-    bar += "]";
-    std::cout << cdim(theme) << bar << creset(theme);
-}
-
-// Compute day of year
-static int day_of_year(const std::tm &tm){
-    static const int mdays[] = {31,28,31,30,31,30,31,31,30,31,30,31};
-    int yday = 0;
-    for(int m=0;m<tm.tm_mon;m++) yday += mdays[m];
-    yday += tm.tm_mday;
-    int year = tm.tm_year + 1900;
-    bool leap = ((year%4==0 && year%100!=0) || (year%400==0));
-    if (leap && tm.tm_mon>1) yday += 1;
-    return yday;
+    rule("└", "┴", "┘");
 }
 
-// NOAA-style solar calculations: equation of time (minutes) and declination (degrees)
-static void solar_params_noaa(int yday, double &eqTimeMin, double &declDeg){
-    // Fractional year in radians (approx)
-    double gamma = 2.0*M_PI/365.0 * (yday - 1 + (12 - 12)/24.0);
-    // Equation of time (minutes)
-    double eq = 229.18*(0.000075 + 0.001868*cos(gamma) - 0.032077*sin(gamma)
-                        - 0.014615*cos(2*gamma) - 0.040849*sin(2*gamma));
-    // Solar declination (radians)
-    double decl = 0.006918 - 0.399912*cos(gamma) + 0.070257*sin(gamma)
-                  - 0.006758*cos(2*gamma) + 0.000907*sin(2*gamma)
-                  - 0.002697*cos(3*gamma) + 0.00148*sin(3*gamma);
-    eqTimeMin = eq;
-    declDeg = decl * 180.0/M_PI;
-}
-
-// Compute local solar noon (hours, local clock) given longitude (deg), tzOffsetHours
-static double solar_noon_local(double longitude, double tzOffsetHours, double eqTimeMin){
-    // time offset in minutes between solar time and local time
-    // true solar time minutes = local clock minutes + eqTime + 4*longitude - 60*tz
-    // set true solar time to 720 (12:00) to get local clock time
-    double localNoonMin = 720 - eqTimeMin - 4*longitude + 60*tzOffsetHours;
-    return localNoonMin / 60.0; // hours
-}
-
-// Hour angle for a given solar altitude angle (deg). Returns degrees >=0.
-static std::optional<double> hour_angle_deg(double latDeg, double declDeg, double altitudeDeg){
-    double lat = deg2rad(latDeg);
-    double decl = deg2rad(declDeg);
-    double alt = deg2rad(altitudeDeg);
-    double cosH = (std::sin(alt) - std::sin(lat)*std::sin(decl)) / (std::cos(lat)*std::cos(decl));
-    if (cosH < -1.0 || cosH > 1.0) return std::nullopt;
-    double H = std::acos(clamp(cosH, -1.0, 1.0)); // radians
-    return rad2deg(H);
-}
-
-// Asr target altitude given madhab factor (1 for Shafi, 2 for Hanafi)
-static double asr_altitude_deg(double latDeg, double declDeg, int factor){
-    // Proper Asr altitude: alt = 90° - arctan(factor + tan(|phi - decl|))
-    double lat = std::fabs(deg2rad(latDeg));
-    double decl = std::fabs(deg2rad(declDeg));
-    double alt = (M_PI/2.0) - std::atan(factor + std::tan(std::fabs(lat - decl)));
-    return rad2deg(alt);
-}
-
-// Get local UTC offset (hours) for current time (approx for today)
-static double local_utc_offset_hours(){
-    using namespace std::chrono;
-    auto t = system_clock::to_time_t(system_clock::now());
-    std::tm lt{}; std::tm gt{};
-#if defined(_WIN32)
-    localtime_s(&lt, &t);
-    gmtime_s(&gt, &t);
-#else
-    localtime_r(&t, &lt);
-    gmtime_r(&t, &gt);
-#endif
-    // mktime treats struct as local time; we need seconds since epoch
-    time_t l = mktime(&lt);
-#if defined(_WIN32)
-    // There is no portable timegm; approximate by difference
-    time_t g = _mkgmtime(&gt);
-#else
-    time_t g = timegm(&gt);
-#endif
-    double diff = std::difftime(l, g); // seconds
-    return diff / 3600.0;
-}
-
-struct PrayerTimes { double fajr, sunrise, dhuhr, asr, maghrib, isha; };
-
-static std::optional<PrayerTimes> compute_prayer_times(const std::tm &date, double latitude, double longitude,
-                                                       const std::string &method, const std::string &madhab,
-                                                       const std::string &high_lat_rule,
-                                                       std::optional<double> tzOverrideHours = std::nullopt){
-    int yday = day_of_year(date);
-    double eqMin=0.0, declDeg=0.0; solar_params_noaa(yday, eqMin, declDeg);
-    double tz = tzOverrideHours.has_value() ? *tzOverrideHours : local_utc_offset_hours();
-    double noon = solar_noon_local(longitude, tz, eqMin);
-
-    // Method presets (angles in degrees, negative altitudes: below horizon)
-    double fajrAngle = 18.0; // default
-    double ishaAngle = 18.0; // default
-    int ishaOffsetMin = -1;  // if >=0, use fixed minutes after Maghrib
-    if (method == "isna") { fajrAngle = 15.0; ishaAngle = 15.0; }
-    else if (method == "mwl") { fajrAngle = 18.0; ishaAngle = 17.0; }
-    else if (method == "umm_al_qura" || method == "makkah") { fajrAngle = 18.5; ishaOffsetMin = 90; }
-    else if (method == "egypt") { fajrAngle = 19.5; ishaAngle = 17.5; }
-    else if (method == "karachi") { fajrAngle = 18.0; ishaAngle = 18.0; }
-    else if (method == "tehran") { fajrAngle = 17.7; ishaAngle = 14.0; }
-    // others can be added
-
-    // Sunrise/Sunset standard altitude includes refraction and solar radius ≈ -0.833°
-    auto Hsr = hour_angle_deg(latitude, declDeg, -0.833);
-    if (!Hsr) return std::nullopt;
-    double sunrise = noon - (*Hsr)/15.0;
-    double sunset  = noon + (*Hsr)/15.0;
-
-    // Fajr/Isha using angles below horizon
-    auto Hf = hour_angle_deg(latitude, declDeg, -fajrAngle);
-    std::optional<double> Hi;
-    if (ishaOffsetMin < 0) {
-        Hi = hour_angle_deg(latitude, declDeg, -ishaAngle);
-    }
-
-    // Handle high latitude basic rule: cap night portions
-    if ((!Hf || (!Hi && ishaOffsetMin < 0)) && (high_lat_rule=="middle_of_the_night" || high_lat_rule=="seventh_of_the_night" || high_lat_rule=="twilight_angle")){
-        double nightLen = (24.0 - sunset + sunrise); // hours from sunset to next sunrise
-        double portion = 0.5; // middle_of_the_night
-        if (high_lat_rule=="seventh_of_the_night") portion = 1.0/7.0;
-        // twilight_angle proportional rule simplified: use angle/60 (~ rough)
-        if (high_lat_rule=="twilight_angle") portion = std::max(fajrAngle, (ishaOffsetMin<0?ishaAngle:0.0)) / 60.0;
-        double adj = portion * nightLen;
-        if (!Hf) { Hf = 15.0 * (noon - (sunrise - adj)); }
-        if (!Hi && ishaOffsetMin < 0) { Hi = 15.0 * ((sunset + adj) - noon); }
-    }
-
-    if (!Hf) return std::nullopt;
-    double fajr = noon - (*Hf)/15.0;
-    double isha = 0.0;
-    if (ishaOffsetMin >= 0) {
-        isha = sunset + (ishaOffsetMin/60.0);
-    } else if (Hi) {
-        isha = noon + (*Hi)/15.0;
-    } else {
-        // fallback if still missing
-        isha = sunset + 1.5; // 90 minutes
-    }
-
-    // Dhuhr is solar noon (can add small offset of few minutes if desired)
-    double dhuhr = noon + 0.0;
-
-    // Asr
-    int factor = (madhab=="hanafi"?2:1);
-    double alt_asr = asr_altitude_deg(latitude, declDeg, factor);
-    auto Ha = hour_angle_deg(latitude, declDeg, alt_asr);
-    if (!Ha) return std::nullopt;
-    double asr = noon + (*Ha)/15.0;
-
-    PrayerTimes pt{fajr, sunrise, dhuhr, asr, sunset, isha};
-    return pt;
-}
-
-static std::string fmt_time(double hours, bool use24h){
-    if (hours < 0) hours += 24.0;
-    if (hours >= 24.0) hours = std::fmod(hours, 24.0);
-    int h = static_cast<int>(std::floor(hours + 1e-9));
-    int m = static_cast<int>(std::floor((hours - h)*60.0 + 0.5));
-    if (m==60){ h=(h+1)%24; m=0; }
-    char buf[16];
-    if (use24h) {
-        std::snprintf(buf, sizeof(buf), "%02d:%02d", h, m);
-    } else {
-        int hh = h%12; if (hh==0) hh=12;
-        const char* ampm = (h<12?"AM":"PM");
-        std::snprintf(buf, sizeof(buf), "%d:%02d %s", hh, m, ampm);
-    }
-    return std::string(buf);
+static void draw_progress_bar(frame::Writer& w, const Theme& theme, const std::string& cells){
+    w << theme.esc.dim << '[' << cells << ']' << theme.esc.reset;
 }
 
 // Localize ASCII digits to Arabic-Indic digits for Arabic UI
@@ -508,171 +232,479 @@ static std::string localize_digits_ar(const std::string &s){
     return out;
 }
 
-static double hours_since_midnight_local(){
-    using namespace std::chrono;
-    auto t = system_clock::to_time_t(system_clock::now());
-    std::tm lt{};
-#if defined(_WIN32)
-    localtime_s(&lt, &t);
-#else
-    localtime_r(&t, &lt);
-#endif
-    return lt.tm_hour + lt.tm_min/60.0 + lt.tm_sec/3600.0;
+// Point the config at a database city (in memory; see save_config)
+static void set_location(settings::Store& store, const City& c){
+    store.set_string("city", c.name + ", " + c.country);
+    store.set_number("latitude", c.lat);
+    store.set_number("longitude", c.lon);
+    store.set_string("timezone", c.tz);
 }
 
-static void ensure_parent_exists(const fs::path& p){
-    std::error_code ec; fs::create_directories(p.parent_path(), ec);
+static bool save_config(settings::Store& store){
+    std::string err;
+    if (store.save(&err)) return true;
+    std::cerr << "Could not save config: " << err << "\n";
+    return false;
 }
 
-static void write_or_update_config(const fs::path& p, const std::unordered_map<std::string, std::string>& updates){
-    std::unordered_map<std::string, std::string> cfg = read_simple_kv(p);
-    for (auto &kv : updates) cfg[kv.first] = kv.second;
-    ensure_parent_exists(p);
-    std::ofstream out(p);
-    if (!out) return;
-    for (auto &kv : cfg){ out << kv.first << " = " << kv.second << "\n"; }
+// Today's prayer times as last shown by render_main_view, with the config
+// they were computed from: a redraw for a new language or theme reuses them
+struct TodayTimes {
+    settings::Config from;
+    int year = -1, yday = -1;
+    std::optional<prayer::PrayerTimes> pt;
+};
+
+// Terminal columns taken by UTF-8 text (one per code point)
+static size_t text_width(const std::string &s){
+    size_t w = 0;
+    for (unsigned char ch : s) if ((ch & 0xC0) != 0x80) ++w;
+    return w;
 }
 
-// Render the main screen from current config without exiting (used by refresh commands)
-static void render_main_view(const char* argv0, const fs::path& config, std::unordered_map<std::string, std::string>& cfg){
-    auto get_raw = [&](const std::string &k)->std::string{
-        auto it = cfg.find(k); return it==cfg.end()?std::string():it->second;
-    };
-    std::string lang = get_raw("language"); if (lang.empty()) lang = "en";
-    std::string colors = get_raw("colors"); if (colors.empty()) colors = "auto";
-    std::string fgS = get_raw("fg"); std::string bgS = get_raw("bg");
-    Theme theme = build_theme(colors, fgS, bgS);
+// The next prayer as the main view shows it: the first time not yet passed
+// (after Isha, Fajr again), the hours left and how far along the interval
+// since the previous time we are
+struct Countdown { int next = 0; double leftH = 0.0; double fraction = 0.0; };
+static Countdown countdown(const prayer::PrayerTimes &pt, double nowH){
+    const double seq[6] = {pt.fajr, pt.sunrise, pt.dhuhr, pt.asr, pt.maghrib, pt.isha};
+    Countdown c;
+    c.next = -1;
+    for (int i=0;i<6;++i){ if (seq[i] - nowH >= -0.0001){ c.next = i; break; } }
+    if (c.next < 0){ c.next = 0; c.leftH = (24.0 - nowH) + seq[0]; }
+    else c.leftH = seq[c.next] - nowH;
+    double prevT = seq[(c.next + 5) % 6], nextT = seq[c.next], now2 = nowH;
+    if (now2 < prevT) now2 += 24.0; // wrap midnight
+    if (nextT < prevT) nextT += 24.0;
+    c.fraction = (now2 - prevT) / std::max(0.001, (nextT - prevT));
+    return c;
+}
 
-    clear_screen();
-    apply_theme_colors(theme);
+// --watch: the parts of render_main_view's screen that change every second,
+// where they are and what they show, so that a tick rewrites only the
+// characters that changed
+struct LiveView {
+    int year = -1, yday = -1, next = -1;    // a new day or prayer redraws everything
+    int clockRow = 0, clockCol = 0;         // "Date/Time (local): " value
+    int nextRow = 0, countCol = 0, barCol = 0;
+    std::string clock, count, bar;          // as shown
+    std::string head;                       // "Next (Fajr) in: ", for Arabic line rewrites
+    bool ar = false;                        // right-to-left: columns are not known
+    std::string textAttr, barAttr;          // theme attributes to rewrite with
+};
+
+static constexpr int kProgressWidth = 30;
+
+static std::string clock_text(const std::tm &lt){
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &lt);
+    return buf;
+}
+
+// HH:MM:SS, counting whole seconds so that it steps by one per tick
+static std::string countdown_text(double leftH){
+    long s = std::max(0L, std::lround(leftH * 3600.0));
+    char buf[32]; std::snprintf(buf, sizeof(buf), "%02ld:%02ld:%02ld", s / 3600, s / 60 % 60, s % 60);
+    return buf;
+}
+
+static std::string progress_cells(double fraction){
+    fraction = std::max(0.0, std::min(1.0, fraction));
+    int filled = (int)std::round(fraction * kProgressWidth);
+    return std::string(filled, '#') + std::string(kProgressWidth - filled, '-');
+}
+
+static constexpr std::string_view kLogo =
+    "   ○○○○○   ○○○○   ○○○○○    Almuslim\n"
+    "  ○      ○   ○   ○      ○   Fast Terminal Prayer Times\n"
+    "  ○   ◐   ○   ○   ○   ★  ○   (C++)\n"
+    "  ○      ○   ○   ○      ○\n"
+    "   ○○○○○     ○     ○○○○○\n";
+
+// Render the main screen from current config without exiting (used by refresh
+// commands). The screen is built in the frame buffer and written in one go.
+// With `live` (--watch) the countdown has seconds and its position is kept.
+static void render_main_view(const fs::path& config, const settings::Config& cfg, TodayTimes& today,
+                             LiveView* live = nullptr){
+    Theme theme = build_theme(cfg.colors, cfg.fg, cfg.bg);
+    const frame::Palette &e = theme.esc;
+    frame::Writer &w = frame::screen();
+
+    // One clock read for the whole view; offset and date come from the cached zone clock
+    zoneclock::ZoneClock &clk = zoneclock::ui_clock();
+    std::tm lt = clk.local_now();
+    // Live views count whole seconds of the clock shown, as the ticks do
+    double nowH = live ? (lt.tm_hour * 3600 + lt.tm_min * 60 + lt.tm_sec) / 3600.0 : clk.hours_since_midnight();
+
+    clear_screen(w);
+    apply_theme_colors(w, theme);
     // Header
-    std::cout << cstr(theme, "\x1b[32m");
-    std::cout << "   ○○○○○   ○○○○   ○○○○○    Almuslim\n";
-    std::cout << "  ○      ○   ○   ○      ○   Fast Terminal Prayer Times\n";
-    std::cout << "  ○   ◐   ○   ○   ○   ★  ○   (C++)\n";
-    std::cout << "  ○      ○   ○   ○      ○\n";
-    std::cout << "   ○○○○○     ○     ○○○○○\n";
-    std::cout << creset(theme);
-    apply_theme_colors(theme);
-    std::cout << "Date/Time (local): " << now_local_iso() << "\n";
-    if (!config.empty()) { std::cout << "Config: " << config.string() << (fs::exists(config)?" (found)":" (missing)") << "\n"; }
-
-    // Helpers
-    auto get = [&](const std::string &k, const std::string &def)->std::string{
-        auto it = cfg.find(k); return it==cfg.end()?def:it->second;
-    };
-    bool ar = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); ar = (L=="ar"||L=="arabic"); }
+    w << e.banner << kLogo << e.reset;
+    apply_theme_colors(w, theme);
+    const std::string_view clockLabel = "Date/Time (local): ";
+    if (live){ live->clockRow = w.row(); live->clockCol = (int)clockLabel.size() + 1; live->clock = clock_text(lt); }
+    w << clockLabel << clock_text(lt) << "\n";
+    if (!config.empty()) { w << "Config: " << config.string() << (fs::exists(config)?" (found)":" (missing)") << "\n"; }
+
+    bool ar = cfg.arabic();
     auto Lbl = [&](const char* en, const char* arLabel){ return ar ? std::string(arLabel) : std::string(en); };
 
-    std::string city = get("city", "(unset)");
-    std::string latS = get("latitude", "");
-    std::string lonS = get("longitude", "");
-    std::string method = get("method", "umm_al_qura");
-    std::string madhab = get("madhab", "shafi");
-    std::string hlr = get("high_latitude_rule", "middle_of_the_night");
-    std::string tzS = get("timezone", "");
-    std::string elevS = get("elevation_m", "");
-    bool use24h = true; { auto v = get("24h","true"); std::string s=v; std::transform(s.begin(),s.end(),s.begin(),::tolower); use24h = (s=="true"||s=="1"||s=="yes"); }
-
-    double latitude=0.0, longitude=0.0;
-    if (!latS.empty()) latitude = std::stod(latS);
-    if (!lonS.empty()) longitude = std::stod(lonS);
-    double elevation_m = 0.0; if (!elevS.empty()){ try { elevation_m = std::stod(elevS); } catch(...) { elevation_m = 0.0; } }
-
-    using namespace std::chrono;
-    auto t = system_clock::to_time_t(system_clock::now());
-    std::tm lt{};
-#if defined(_WIN32)
-    localtime_s(&lt, &t);
-#else
-    localtime_r(&t, &lt);
-#endif
-
-    auto parse_tz_hours = [](const std::string &s)->std::optional<double>{
-        if (s.empty()) return std::nullopt; std::string x = s; for(char &c: x) c = (char)std::tolower((unsigned char)c);
-        if (x=="utc" || x=="gmt" || x=="z") return 0.0;
-        if (x=="asia/riyadh" || x=="asia/makkah" || x=="asia/jeddah") return 3.0;
-        if (x.rfind("utc",0)==0) x = x.substr(3);
-        if (x.rfind("gmt",0)==0) x = x.substr(3);
-        x.erase(std::remove_if(x.begin(), x.end(), ::isspace), x.end()); if (x.empty()) return std::nullopt;
-        int sign = 1; size_t i=0; if (x[0]=='+'){sign=1;i=1;} else if (x[0]=='-'){sign=-1;i=1;}
-        size_t colon = x.find(':', i); try{
-            if (colon==std::string::npos) { return sign * std::stod(x.substr(i)); }
-            double h = std::stod(x.substr(i, colon-i)); double m = std::stod(x.substr(colon+1)); return sign * (h + m/60.0);
-        } catch(...) { return std::nullopt; }
-    };
-    std::optional<double> tzOverride = parse_tz_hours(tzS);
-    auto ptOpt = compute_prayer_times(lt, latitude, longitude, method, madhab, hlr, tzOverride);
-    if (!ptOpt) { std::cout << "\nUnable to compute prayer times for your location/date.\n"; return; }
-    PrayerTimes pt = *ptOpt;
-
-    // Hijri
-    fs::path exeDir = fs::path(argv0).parent_path();
-    fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-    if (!fs::exists(dataDir / "hijri/umm_al_qura_month_starts.csv")) {
-        fs::path sysData = "/usr/share/almuslim/data"; if (fs::exists(sysData / "hijri/umm_al_qura_month_starts.csv")) dataDir = sysData;
+    std::string city = cfg.city.empty() ? "(unset)" : cfg.city;
+    const std::string &method = cfg.method, &madhab = cfg.madhab, &hlr = cfg.highLatRule;
+    bool use24h = cfg.use24h;
+    double latitude = cfg.latitude.value_or(0.0), longitude = cfg.longitude.value_or(0.0);
+
+    if (today.yday != lt.tm_yday || today.year != lt.tm_year
+        || (settings::diff(today.from, cfg) & (settings::ChangeLocation | settings::ChangeCalculation))){
+        std::optional<double> tzOverride = prayer::parse_tz_hours(cfg.timezone);
+        if (!tzOverride) tzOverride = clk.utc_offset_hours();
+        today.pt = prayer::compute_prayer_times(lt, latitude, longitude, method, madhab, hlr, tzOverride);
+        today.from = cfg;
+        today.year = lt.tm_year;
+        today.yday = lt.tm_yday;
     }
-#endif
-    static bool hjLoaded2 = hijri::load_umm_al_qura(dataDir);
-    std::string hijriStr;
-    if (hjLoaded2){ auto hd = hijri::hijri_for_date(lt); if (hd){ const char* mname = ar ? hijri::month_name_ar(hd->month) : hijri::month_name_en(hd->month); char buf[128]; std::snprintf(buf, sizeof(buf), "%d %s %d AH", hd->day, mname, hd->year); hijriStr = buf; } }
-    if (hijriStr.empty()) hijriStr = approx_hijri_date(lt);
+    if (live){ live->year = lt.tm_year; live->yday = lt.tm_yday; live->next = -1; }
+    if (!today.pt) { w << "\nUnable to compute prayer times for your location/date.\n"; w.flush(); return; }
+    const prayer::PrayerTimes &pt = *today.pt;
+    Countdown cd = countdown(pt, nowH);
+
+    // Hijri (table published by main; a refresh may have swapped in a newer one)
+    std::string hijriStr = hijri_display(lt, ar);
     if (ar) hijriStr = localize_digits_ar(hijriStr);
-    std::cout << "\n" << cstr(theme, "\x1b[36m") << (ar ? rtl_wrap(hijriStr) : hijriStr) << creset(theme) << "\n"; apply_theme_colors(theme);
+    w << "\n" << e.hijri << (ar ? rtl_wrap(hijriStr) : hijriStr) << e.reset << "\n"; apply_theme_colors(w, theme);
 
     // Summary + boxed table
     {
-        std::string sum = std::string("\n") + cdim(theme) + Lbl("City","المدينة") + ": " + creset(theme) + city
-                        + "  " + cdim(theme) + Lbl("Method","الطريقة") + ": " + creset(theme) + method + " (" + madhab + ")\n";
-        bool arSum = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); arSum = (L=="ar"||L=="arabic"); }
-        std::cout << (arSum ? rtl_wrap(sum) : sum);
+        std::string sum = std::string("\n") + e.dim + Lbl("City","المدينة") + ": " + e.reset + city
+                        + "  " + e.dim + Lbl("Method","الطريقة") + ": " + e.reset + method + " (" + madhab + ")\n";
+        w << (ar ? rtl_wrap(sum) : sum);
     }
     std::vector<std::string> names = { Lbl("Fajr","الفجر"), Lbl("Sunrise","الشروق"), Lbl("Dhuhr","الظهر"), Lbl("Asr","العصر"), Lbl("Maghrib","المغرب"), Lbl("Isha","العشاء") };
-    std::vector<std::string> timesV = { fmt_time(pt.fajr, use24h), fmt_time(pt.sunrise, use24h), fmt_time(pt.dhuhr, use24h), fmt_time(pt.asr, use24h), fmt_time(pt.maghrib, use24h), fmt_time(pt.isha, use24h) };
+    std::vector<std::string> timesV = { prayer::fmt_time(pt.fajr, use24h), prayer::fmt_time(pt.sunrise, use24h), prayer::fmt_time(pt.dhuhr, use24h), prayer::fmt_time(pt.asr, use24h), prayer::fmt_time(pt.maghrib, use24h), prayer::fmt_time(pt.isha, use24h) };
     if (ar){ for (auto &x : timesV) x = localize_digits_ar(x); }
-    int nextIdx = -1; { double nowHtmp = hours_since_midnight_local(); std::vector<double> seqH = {pt.fajr, pt.sunrise, pt.dhuhr, pt.asr, pt.maghrib, pt.isha}; for (int i=0;i<(int)seqH.size();++i){ if (seqH[i] - nowHtmp >= -0.0001){ nextIdx = i; break; }} if (nextIdx < 0) nextIdx = 0; }
-    draw_boxed_table(theme, names, timesV, nextIdx, ar);
+    draw_boxed_table(w, theme, names, timesV, cd.next, ar);
 
     // Day length
     double dayLenH = pt.maghrib - pt.sunrise; if (dayLenH < 0) dayLenH += 24.0; int dlh = (int)std::floor(dayLenH + 1e-9); int dlm = (int)std::floor((dayLenH - dlh)*60.0 + 0.5); if (dlm==60){dlh+=1;dlm=0;}
     char dBuf[32]; std::snprintf(dBuf, sizeof(dBuf), "%02d:%02d", std::max(0,dlh), std::max(0,dlm)); std::string dStr = dBuf; if (ar) dStr = localize_digits_ar(dStr);
     {
         std::string line = Lbl("Day length","طول النهار") + std::string(": ") + dStr + "\n";
-        std::cout << (ar ? rtl_wrap(line) : line);
+        w << (ar ? rtl_wrap(line) : line);
     }
 
     // Next prayer with progress
-    double nowH = hours_since_midnight_local(); std::vector<std::pair<std::string,double>> seq = {{"Fajr", pt.fajr},{"Sunrise", pt.sunrise},{"Dhuhr", pt.dhuhr},{"Asr", pt.asr},{"Maghrib", pt.maghrib},{"Isha", pt.isha}};
-    std::string nextName = ""; double nextInH = 0.0; for (auto &p: seq){ double dt = p.second - nowH; if (dt < -0.0001) continue; nextName = p.first; nextInH = dt; break; } if (nextName.empty()) { nextName = seq.front().first; nextInH = (24.0 - nowH) + seq.front().second; }
-    if (ar){ if (nextName=="Fajr") nextName="الفجر"; else if (nextName=="Sunrise") nextName="الشروق"; else if (nextName=="Dhuhr") nextName="الظهر"; else if (nextName=="Asr") nextName="العصر"; else if (nextName=="Maghrib") nextName="المغرب"; else if (nextName=="Isha") nextName="العشاء"; }
-    int h = (int)std::floor(nextInH + 1e-9); int m = (int)std::floor((nextInH - h)*60.0 + 0.5); if (m==60){ h+=1; m=0; } char buf2[32]; std::snprintf(buf2, sizeof(buf2), "%02d:%02d", std::max(0,h), std::max(0,m)); std::string nextStr = buf2; if (ar) nextStr = localize_digits_ar(nextStr);
-    double prevT=0.0, nextT=0.0, nowH2=hours_since_midnight_local(); { int idx = nextIdx; int prevIdx = (idx-1>=0?idx-1:(int)seq.size()-1); prevT = seq[prevIdx].second; nextT = seq[idx].second; if (nowH2 < prevT) nowH2 += 24.0; if (nextT < prevT) nextT += 24.0; }
-    double frac = (nowH2 - prevT) / std::max(0.001, (nextT - prevT));
+    const std::string &nextName = names[cd.next];
+    double nextInH = cd.leftH;
+    int h = (int)std::floor(nextInH + 1e-9); int m = (int)std::floor((nextInH - h)*60.0 + 0.5); if (m==60){ h+=1; m=0; } char buf2[32]; std::snprintf(buf2, sizeof(buf2), "%02d:%02d", std::max(0,h), std::max(0,m)); std::string nextStr = buf2;
+    if (live) nextStr = countdown_text(nextInH);
+    if (ar) nextStr = localize_digits_ar(nextStr);
+    std::string head = Lbl("Next","التالي") + " (" + nextName + ") " + Lbl("in","بعد") + ": ";
+    std::string cells = progress_cells(cd.fraction);
     {
-        std::string line = std::string("\n") + Lbl("Next","التالي") + " (" + nextName + ") " + Lbl("in","بعد") + ": " + nextStr + "  ";
-        std::cout << (ar ? rtl_wrap(line) : line);
+        std::string line = std::string("\n") + head + nextStr + "  ";
+        w << (ar ? rtl_wrap(line) : line);
+    }
+    if (live){
+        live->next = cd.next;
+        live->nextRow = w.row();
+        live->countCol = (int)text_width(head) + 1;
+        live->barCol = live->countCol + (int)text_width(nextStr) + 3;
+        live->count = nextStr; live->bar = cells; live->head = head;
+        live->ar = ar;
+        live->textAttr = e.resetBase;
+        live->barAttr = e.resetBase + e.dim;
+    }
+    draw_progress_bar(w, theme, cells); w << "\n";
+    w.flush();
+}
+// Append cursor moves and the characters of `now` that differ from `shown`
+// at (row, col); `shown` becomes `now`. Both are single-byte text.
+static void patch_field(frame::Writer &w, int row, int col, std::string &shown, const std::string &now,
+                        const std::string &attr){
+    for (size_t i = 0; i < now.size();){
+        if (i < shown.size() && shown[i] == now[i]){ ++i; continue; }
+        size_t j = i;
+        while (j < now.size() && !(j < shown.size() && shown[j] == now[j])) ++j;
+        char pos[32]; std::snprintf(pos, sizeof(pos), "\x1b[%d;%dH", row, col + (int)i);
+        w << pos << attr << std::string_view(now).substr(i, j - i);
+        i = j;
+    }
+    shown = now;
+}
+
+// One --watch tick: rewrite what changed since the last frame in place.
+// False when the whole view has to be drawn again (a new day or the next
+// prayer).
+static bool update_live_view(const TodayTimes &today, LiveView &live){
+    std::tm lt = zoneclock::ui_clock().local_now();
+    if (lt.tm_year != live.year || lt.tm_yday != live.yday) return false;
+    if (!today.pt) return true; // the message stays until tomorrow
+    double nowH = (lt.tm_hour * 3600 + lt.tm_min * 60 + lt.tm_sec) / 3600.0;
+    Countdown cd = countdown(*today.pt, nowH);
+    if (cd.next != live.next) return false;
+
+    frame::Writer &w = frame::screen();
+    patch_field(w, live.clockRow, live.clockCol, live.clock, clock_text(lt), live.textAttr);
+    std::string count = countdown_text(cd.leftH), cells = progress_cells(cd.fraction);
+    if (live.ar){
+        // Bidi reordering moves the digits around: rewrite the whole line
+        count = localize_digits_ar(count);
+        if (count != live.count || cells != live.bar){
+            char pos[32]; std::snprintf(pos, sizeof(pos), "\x1b[%d;1H", live.nextRow);
+            w << pos << live.textAttr << "\x1b[2K" << rtl_wrap(live.head + count + "  ")
+              << live.barAttr << '[' << cells << ']' << live.textAttr;
+            live.count = count;
+            live.bar = cells;
+        }
+    } else {
+        patch_field(w, live.nextRow, live.countCol, live.count, count, live.textAttr);
+        patch_field(w, live.nextRow, live.barCol, live.bar, cells, live.barAttr);
+    }
+    if (w.size()){
+        // Park the cursor below the view
+        char pos[32]; std::snprintf(pos, sizeof(pos), "\x1b[%d;1H", live.nextRow + 1);
+        w << pos;
+        w.flush();
+    }
+    return true;
+}
+
+static volatile std::sig_atomic_t g_watchStop = 0;
+static volatile std::sig_atomic_t g_watchResized = 0;
+
+// --watch: the main view kept live for always-on displays. The times are
+// computed once a day; every second only the clock, the countdown and the
+// progress cells that changed are rewritten with cursor addressing. The
+// screen is cleared only for a new prayer, a new day, a config change or a
+// terminal resize. Ctrl-C exits.
+static int run_watch(const fs::path& config, settings::Store& store){
+    const settings::Config &cfg = store.config();
+    if (!cfg.has_location()){
+        std::cerr << "No location in " << config.string() << " (run al-muslim --setup)\n";
+        return 1;
+    }
+    std::signal(SIGINT, [](int){ g_watchStop = 1; });
+    std::signal(SIGTERM, [](int){ g_watchStop = 1; });
+#if defined(SIGWINCH)
+    std::signal(SIGWINCH, [](int){ g_watchResized = 1; });
+#endif
+    frame::Writer &w = frame::screen();
+    w << "\x1b[?25l"; // hide the cursor; it is parked below the view
+    TodayTimes today;
+    LiveView live;
+    platform::FileWatcher watcher(config);
+    platform::SecondTicker ticker;
+    bool redraw = true;
+    while (!g_watchStop){
+        if (watcher.changed()){
+            settings::Config before = cfg;
+            // Same filter as the REPL: profiles and [updates]/[paths] are not shown
+            if (store.reload() && (settings::diff(before, cfg) & ~unsigned(settings::ChangeProfiles | settings::ChangeOther))) redraw = true;
+        }
+        if (g_watchResized){ g_watchResized = 0; redraw = true; }
+        if (redraw || !update_live_view(today, live)) render_main_view(config, cfg, today, &live);
+        redraw = false;
+        ticker.wait();
+    }
+    w << "\x1b[0m\x1b[?25h\n";
+    w.flush();
+    return 0;
+}
+
+// --all-profiles: today's times for the main location and every [[profiles]]
+// entry, one row each. The solar parameters depend only on the date and are
+// computed once for all rows; each distinct timezone setting is resolved once.
+static int print_all_profiles(const fs::path& config, const settings::Config& cfg){
+    std::vector<settings::Profile> sites;
+    sites.reserve(cfg.profiles.size() + 1);
+    if (cfg.has_location()){
+        settings::Profile home;
+        home.name = cfg.city.empty() ? "(config)" : cfg.city;
+        home.latitude = *cfg.latitude;
+        home.longitude = *cfg.longitude;
+        sites.push_back(home);
     }
-    draw_progress_bar(theme, frac); std::cout << "\n";
+    sites.insert(sites.end(), cfg.profiles.begin(), cfg.profiles.end());
+    if (sites.empty()){ std::cerr << "No location or [[profiles]] in the config\n"; return 1; }
+
+    zoneclock::ZoneClock &clk = zoneclock::ui_clock();
+    std::tm lt = clk.local_now();
+    const prayer::SolarDay sd = prayer::solar_day(lt);
+    const double localOffset = clk.utc_offset_hours();
+    const std::time_t now = std::time(nullptr);
+    // Each distinct zone resolved once: numeric offsets directly, names via zoneinfo
+    std::map<std::string, std::optional<double>> zones;
+    std::vector<settings::ParseError> errors;
+
+    bool ar = cfg.arabic();
+    auto Lbl = [&](const char* en, const char* arLabel){ return ar ? std::string(arLabel) : std::string(en); };
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(sites.size() + 1);
+    rows.push_back({ Lbl("Location","الموقع"), Lbl("Fajr","الفجر"), Lbl("Sunrise","الشروق"), Lbl("Dhuhr","الظهر"),
+                     Lbl("Asr","العصر"), Lbl("Maghrib","المغرب"), Lbl("Isha","العشاء") });
+    for (const auto &p : sites){
+        const std::string &tzS = p.timezone.empty() ? cfg.timezone : p.timezone;
+        auto zone = zones.find(tzS);
+        if (zone == zones.end()){
+            std::optional<double> h = tzS.empty() ? std::optional<double>(localOffset) : prayer::parse_tz_hours(tzS);
+            if (!h) h = zoneclock::zone_offset_hours(tzS, now);
+            zone = zones.emplace(tzS, h).first;
+        }
+        // An unknown zone shows "-" rather than times in the machine's zone
+        if (!zone->second) errors.push_back({p.line, "unknown timezone '" + tzS + "' for " + p.name});
+        std::optional<prayer::PrayerTimes> pt;
+        if (zone->second)
+            pt = prayer::compute_prayer_times(sd, p.latitude, p.longitude,
+                                              p.method.empty() ? cfg.method : p.method,
+                                              p.madhab.empty() ? cfg.madhab : p.madhab,
+                                              p.highLatRule.empty() ? cfg.highLatRule : p.highLatRule,
+                                              *zone->second);
+        std::vector<std::string> row;
+        row.reserve(7);
+        row.push_back(p.name);
+        if (pt){
+            const double t[6] = { pt->fajr, pt->sunrise, pt->dhuhr, pt->asr, pt->maghrib, pt->isha };
+            for (int i=0;i<6;++i){
+                std::string v = prayer::fmt_time(t[i] + p.offsetMin[i] / 60.0, cfg.use24h);
+                row.push_back(ar ? localize_digits_ar(v) : v);
+            }
+        } else {
+            row.resize(7, "-");
+        }
+        rows.push_back(std::move(row));
+    }
+
+    std::vector<size_t> w(7, 0);
+    for (const auto &r : rows) for (size_t i=0;i<r.size();++i) w[i] = std::max(w[i], text_width(r[i]));
+    Theme theme = build_theme(cfg.colors, cfg.fg, cfg.bg);
+    const frame::Palette &e = theme.esc;
+    std::string line = e.grey, bar = e.grey + "│" + e.reset;
+    auto rule = [&](const char* l, const char* m, const char* r){
+        std::string s = line + l;
+        for (size_t i=0;i<w.size();++i){
+            for (size_t k=0;k<w[i]+2;++k) s += "─";
+            s += i+1 < w.size() ? m : r;
+        }
+        return s + e.reset + "\n";
+    };
+    std::string out;
+    char dstr[32]; std::snprintf(dstr, sizeof(dstr), "%04d-%02d-%02d", lt.tm_year+1900, lt.tm_mon+1, lt.tm_mday);
+    out += dstr; out += "\n";
+    out += rule("┌", "┬", "┐");
+    for (size_t r=0;r<rows.size();++r){
+        out += bar;
+        for (size_t i=0;i<rows[r].size();++i){
+            std::string pad(w[i] - text_width(rows[r][i]), ' ');
+            out += ' ';
+            if (r == 0) out += e.bold;
+            // Names left-aligned, times right-aligned
+            if (i == 0) out += rows[r][i] + pad; else out += pad + rows[r][i];
+            if (r == 0) out += e.reset;
+            out += ' '; out += bar;
+        }
+        out += "\n";
+        if (r == 0) out += rule("├", "┼", "┤");
+    }
+    out += rule("└", "┴", "┘");
+    std::cout << out;
+    for (const auto &err : errors){
+        std::cerr << config.string();
+        if (err.line) std::cerr << ":" << err.line;
+        std::cerr << ": " << err.message << "\n";
+    }
+    return 0;
 }
+
+// --once / --format: today's times and exit. Reads only the config (and the
+// Hijri table if the format shows it): no banner, onboarding, city database
+// or iostreams, and the output goes out in one write. With the cache, a
+// repeat run on the same day with the same config reads today.bin and
+// nothing else.
+static int print_once(const oneshot::Options& opt, bool useCache){
+    ALMUSLIM_TRACE_SPAN(resolve, "config_resolve");
+    fs::path config = platform::resolve_config_path();
+    ALMUSLIM_TRACE_END(resolve);
+    zoneclock::ZoneClock &clk = zoneclock::ui_clock();
+    std::tm lt = clk.local_now();
+    const double nowH = clk.hours_since_midnight();
+    const double offsetH = clk.utc_offset_hours();
+    auto emit = [&](const oneshot::Day& today, const oneshot::Day* tomorrow){
+        ALMUSLIM_TRACE_SPAN(render, "render");
+        std::string out;
+        oneshot::format(opt, today, tomorrow, nowH, out);
+        bool ok = platform::write_stdout(out);
+        ALMUSLIM_TRACE_END(render);
+        trace::finish();
+        return ok ? 0 : 1;
+    };
+
+    fs::path cachePath = useCache ? daycache::default_path() : fs::path();
+    daycache::Key key;
+    key.stamp = daycache::stamp(config);
+    key.date = daycache::date_key(lt);
+    key.utcOffsetMin = (int)std::lround(offsetH * 60.0);
+    if (useCache){
+        ALMUSLIM_TRACE_SPAN(cache, "cache_lookup");
+        key.dataId = daycache::data_id();
+        auto hit = daycache::lookup(cachePath, key);
+        ALMUSLIM_TRACE_END(cache);
+        // A hit on the cached tomorrow has no next day yet; the parse below
+        // computes it and re-stores the file
+        if (hit && hit->tomorrow) return emit(hit->today, &*hit->tomorrow);
+    }
+
+    std::vector<settings::ParseError> errors;
+    ALMUSLIM_TRACE_SPAN(parse, "read_config");
+    settings::Config cfg = settings::load(config, &errors);
+    ALMUSLIM_TRACE_END(parse);
+    for (const auto &e : errors) std::fprintf(stderr, "%s:%zu: %s\n", config.string().c_str(), e.line, e.message.c_str());
+    if (!cfg.has_location()){
+        std::fprintf(stderr, "No location in %s (run al-muslim --setup)\n", config.string().c_str());
+        return 1;
+    }
+    // A config with errors is not cached, so that they keep being reported
+    useCache = useCache && errors.empty();
+    const bool systemZone = !prayer::parse_tz_hours(cfg.timezone);
+    if (useCache){
+        // A config saved again without a relevant change still matches; the
+        // file is re-keyed to the new stamp so the next run skips the parse
+        key.configHash = daycache::config_hash(cfg);
+        if (auto hit = daycache::lookup(cachePath, key)){
+            if (!hit->tomorrow){
+                resources::load_hijri();
+                hit->tomorrow = oneshot::compute_day(cfg, add_days_local(lt, 1), offsetH, true);
+            }
+            if (hit->tomorrow) daycache::store(cachePath, key, *key.configHash, systemZone, hit->today, *hit->tomorrow);
+            return emit(hit->today, hit->tomorrow ? &*hit->tomorrow : nullptr);
+        }
+    }
+    bool withHijri = useCache || oneshot::needs_hijri(opt);
+    if (withHijri) resources::load_hijri();
+    ALMUSLIM_TRACE_SPAN(compute, "compute");
+    auto today = oneshot::compute_day(cfg, lt, offsetH, withHijri);
+    if (!today){ std::fprintf(stderr, "Unable to compute prayer times for your location/date.\n"); return 1; }
+    std::optional<oneshot::Day> tomorrow;
+    if (useCache) tomorrow = oneshot::compute_day(cfg, add_days_local(lt, 1), offsetH, true);
+    ALMUSLIM_TRACE_END(compute);
+    if (tomorrow){
+        ALMUSLIM_TRACE_SCOPE("cache_store");
+        daycache::store(cachePath, key, *key.configHash, systemZone, *today, *tomorrow);
+    }
+    return emit(*today, tomorrow ? &*tomorrow : nullptr);
+}
+
 // Guided onboarding on first run: welcome, city, language, clock, background
-static void onboarding_wizard(const fs::path& config, const fs::path& exeDir){
+static void onboarding_wizard(settings::Store& store){
     // Styles
-    Theme t = build_theme("dark", "231", "23"); // greenish bg for onboarding
-    clear_screen(); apply_theme_colors(t);
-    std::cout << cbold(t) << "\n\n    Welcome to Almuslim" << creset(t) << "\n\n";
+    Theme t = build_theme(settings::ColorMode::Dark, "231", "23"); // greenish bg for onboarding
+    frame::Writer &w = frame::screen();
+    clear_screen(w); apply_theme_colors(w, t); w.flush();
+    std::cout << t.esc.bold << "\n\n    Welcome to Almuslim" << t.esc.reset << "\n\n";
     std::cout << "This wizard will help you set up your city and preferences.\n";
     std::cout << "Press Enter to start..."; std::string tmp; std::getline(std::cin, tmp);
 
     // Load cities
-    fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-    if (!fs::exists(dataDir / "cities.csv")) {
-        fs::path sysData = "/usr/share/almuslim/data";
-        if (fs::exists(sysData / "cities.csv")) dataDir = sysData;
-    }
-#endif
-    auto cities = load_cities(dataDir);
+    const citydb::Index& cities = resources::cities();
     std::optional<City> chosen = prompt_city_free_text(cities);
     if (!chosen){ std::cout << "Setup cancelled.\n"; return; }
 
@@ -684,11 +716,11 @@ static void onboarding_wizard(const fs::path& config, const fs::path& exeDir){
         if (tl=="ar"||tl=="arabic") language = "ar";
     }
     // Clock
-    std::string use24 = "true";
+    bool use24 = true;
     std::cout << "24-hour clock? [Y/n] (default Y): ";
     std::getline(std::cin, tmp); if (!tmp.empty()){
         std::string tl = tmp; for(char &c: tl) c=(char)std::tolower((unsigned char)c);
-        if (tl=="n"||tl=="no") use24 = "false";
+        if (tl=="n"||tl=="no") use24 = false;
     }
     // Method and Madhab
     std::cout << "\nCalculation method? [umm_al_qura|mwl|isna|egypt|karachi|tehran] (default umm_al_qura): ";
@@ -701,21 +733,14 @@ static void onboarding_wizard(const fs::path& config, const fs::path& exeDir){
     std::string bg = ""; std::getline(std::cin, bg);
     if (bg=="none"||bg=="off") bg.clear();
 
-    const City &c = *chosen;
-    auto q = [](const std::string &s){ return '"' + s + '"'; };
-    std::unordered_map<std::string,std::string> updates;
-    updates["city"] = q(c.name + ", " + c.country);
-    updates["latitude"] = std::to_string(c.lat);
-    updates["longitude"] = std::to_string(c.lon);
-    updates["timezone"] = q(c.tz);
-    updates["method"] = q(method);
-    updates["madhab"] = q(madhab);
-    updates["high_latitude_rule"] = q("middle_of_the_night");
-    updates["24h"] = q(use24);
-    if (!bg.empty()) updates["bg"] = q(bg);
-    updates["language"] = q(language);
-    write_or_update_config(config, updates);
-    std::cout << "\nSaved config to: " << config.string() << "\n\n";
+    set_location(store, *chosen);
+    store.set_string("method", method);
+    store.set_string("madhab", madhab);
+    store.set_string("high_latitude_rule", "middle_of_the_night");
+    store.set_bool("24h", use24);
+    if (!bg.empty()) store.set_string("bg", bg);
+    store.set_string("language", language);
+    if (save_config(store)) std::cout << "\nSaved config to: " << store.path().string() << "\n\n";
 }
 
 int main(int argc, char** argv) {
@@ -723,228 +748,351 @@ int main(int argc, char** argv) {
 #if defined(_WIN32)
         enable_windows_utf8_and_ansi();
 #endif
+        // Subcommands own the rest of the command line; the global flags below
+        // apply only to the default interactive / one-shot mode
+
+        // Compile data/cities.csv into the memory-mapped binary index (data/cities.idx)
+        if (argc > 1 && std::string(argv[1]) == "build-index"){
+            // The data directory in use, or the one next to the executable
+            fs::path dataDir = resources::find("cities.csv").parent_path();
+            if (dataDir.empty()) dataDir = resources::exe_dir() / "data";
+            fs::path out;
+            for (int i=2;i<argc;i++){
+                std::string a = argv[i];
+                if (a == "--data" && i+1 < argc) dataDir = argv[++i];
+                else if (a == "--out" && i+1 < argc) out = argv[++i];
+            }
+            if (out.empty()) out = dataDir / "cities.idx";
+            std::string err;
+            std::vector<citydb::CsvError> bad;
+            long n = citydb::build_index_file(dataDir, out, &err, &bad);
+            for (const auto& e : bad) std::cerr << (dataDir / "cities.csv").string() << ":" << e.line << ": " << e.message << "\n";
+            if (n < 0){ std::cerr << "build-index failed: " << err << "\n"; return 1; }
+            std::cout << "Indexed " << n << " cities into " << out.string() << "\n";
+            return 0;
+        }
+
+        // Bulk reverse lookup: nearest known city for every "lat,lon" line
+        if (argc > 1 && std::string(argv[1]) == "snap"){
+            fs::path dataDir; // empty: resources::cities()
+            std::string inPath, outPath;
+            double maxKm = kSnapRadiusKm;
+            unsigned threads = 0;
+            for (int i=2;i<argc;i++){
+                std::string a = argv[i];
+                bool hasVal = i+1 < argc;
+                if (a == "--data" && hasVal) dataDir = argv[++i];
+                else if (a == "--in" && hasVal) inPath = argv[++i];
+                else if (a == "--out" && hasVal) outPath = argv[++i];
+                else if (a == "--max-km" && hasVal) maxKm = std::atof(argv[++i]);
+                else if (a == "--threads" && hasVal) threads = (unsigned)std::max(0, std::atoi(argv[++i]));
+                else {
+                    std::cerr << "Usage: al-muslim snap [--in <file>] [--out <file>] [--max-km <km>] [--threads <n>] [--data <dir>]\n"
+                              << "Reads lat,lon lines (stdin by default) and appends city,country,tz,km of the nearest city.\n";
+                    return 1;
+                }
+            }
+            const citydb::Index& cities = dataDir.empty() ? resources::cities() : citydb::load(dataDir);
+            if (cities.empty()){ std::cerr << "No city database in " << (dataDir.empty() ? resources::cities_source() : dataDir.string()) << "\n"; return 1; }
+            std::ifstream fin; std::ofstream fout;
+            if (!inPath.empty()){ fin.open(inPath, std::ios::binary); if (!fin){ std::cerr << "Cannot read " << inPath << "\n"; return 1; } }
+            if (!outPath.empty()){ fout.open(outPath, std::ios::binary | std::ios::trunc); if (!fout){ std::cerr << "Cannot write " << outPath << "\n"; return 1; } }
+            std::ios::sync_with_stdio(false);
+            long n = citydb::snap_points(cities, inPath.empty() ? std::cin : fin, outPath.empty() ? std::cout : fout, maxKm, threads);
+            std::cerr << "Snapped " << n << " points\n";
+            return 0;
+        }
+
+        // Ramadan timetable export for many cities (non-interactive; never runs onboarding)
+        if (argc > 1 && std::string(argv[1]) == "imsakiyah"){
+            imsakiyah::Options opt;
+            std::string citiesArg, citiesFile;
+            for (int i=2;i<argc;i++){
+                std::string a = argv[i];
+                bool hasVal = i+1 < argc;
+                if (a == "--year" && hasVal) opt.year = std::atoi(argv[++i]);
+                else if (a == "--cities" && hasVal) citiesArg = argv[++i];
+                else if (a == "--cities-file" && hasVal) citiesFile = argv[++i];
+                else if (a == "--imsak" && hasVal) opt.imsakMinutes = std::atoi(argv[++i]);
+                else if (a == "--format" && hasVal) opt.json = (std::string(argv[++i]) == "json");
+                else if (a == "--out" && hasVal) opt.outDir = argv[++i];
+                else if (a == "--threads" && hasVal) opt.threads = (unsigned)std::max(0, std::atoi(argv[++i]));
+                else if (a == "--tabular") opt.allowTabular = true;
+            }
+            if (opt.year <= 0 || (citiesArg.empty() && citiesFile.empty())){
+                std::cerr << "Usage: al-muslim imsakiyah --year <AH> --cities <name,name,...|all> [--cities-file <path>]\n"
+                          << "                           [--imsak <minutes>] [--format csv|json] [--out <dir>] [--threads <n>] [--tabular]\n";
+                return 1;
+            }
+            // Calculation preferences come from the config when there is one
+            fs::path config = platform::resolve_config_path();
+            if (!config.empty() && fs::exists(config)){
+                settings::Config cfg = settings::load(config);
+                opt.method = cfg.method;
+                opt.madhab = cfg.madhab;
+                opt.highLatRule = cfg.highLatRule;
+                opt.use24h = cfg.use24h;
+            }
+            const citydb::Index& cities = resources::cities();
+            resources::load_hijri();
+            std::vector<City> selected;
+            if (citiesArg == "all"){
+                selected.reserve(cities.size());
+                for (size_t i=0;i<cities.size();++i) selected.push_back(cities.city(i));
+            } else {
+                std::vector<std::string> queries;
+                auto add_query = [&](std::string q){
+                    q.erase(q.begin(), std::find_if(q.begin(), q.end(), [](unsigned char c){ return !std::isspace(c); }));
+                    q.erase(std::find_if(q.rbegin(), q.rend(), [](unsigned char c){ return !std::isspace(c); }).base(), q.end());
+                    if (!q.empty()) queries.push_back(q);
+                };
+                std::stringstream ss(citiesArg); std::string part;
+                while (std::getline(ss, part, ',')) add_query(part);
+                if (!citiesFile.empty()){
+                    std::ifstream in(citiesFile); std::string line;
+                    while (std::getline(in, line)) add_query(line);
+                }
+                for (const auto &q : queries){
+                    auto m = find_best_city_match(cities, q);
+                    if (m) selected.push_back(*m);
+                    else std::cerr << "No matching city for '" << q << "', skipped.\n";
+                }
+            }
+            if (selected.empty()){ std::cerr << "No cities selected.\n"; return 1; }
+            int n = imsakiyah::generate(opt, selected, std::cout);
+            if (n < 0){
+                std::cerr << "Ramadan " << opt.year << " AH is not covered by the Umm al-Qura table"
+                          << " (pass --tabular to use the arithmetic calendar).\n";
+                return 1;
+            }
+            if (!opt.outDir.empty()) std::cerr << "Wrote " << n << " timetables to " << opt.outDir.string() << "\n";
+            return 0;
+        }
+
         bool askEveryLaunch = false;
         bool showWeek = false;
         std::optional<std::string> weekCsvPath;
         bool detectLocation = false; // future hook
+        std::optional<std::string> hijriMonthArg; // "1448-09": print that Hijri month and exit
+        bool hijriCheck = false; // compare the Umm al-Qura table with the tabular calendar and exit
+        bool allProfiles = false; // print every [[profiles]] location in one table and exit
+        std::optional<oneshot::Options> once; // --once / --format: print today's times and exit
+        bool onceCache = true;                // --no-cache: compute even if today.bin matches
+        std::optional<std::string> tracePath; // --trace-startup [file]: time the startup phases
+        bool watch = false;                   // --watch: keep the main view live, no prompt
         for (int i=1;i<argc;i++){
             std::string a = argv[i];
             if (a == "--ask") askEveryLaunch = true;
             if (a == "--week") showWeek = true;
             if (a == "--week-csv" && i+1 < argc) { weekCsvPath = std::string(argv[++i]); }
             if (a == "--detect-location") detectLocation = true;
+            if (a == "--hijri-month" && i+1 < argc) { hijriMonthArg = std::string(argv[++i]); }
+            if (a == "--hijri-check") hijriCheck = true;
+            if (a == "--all-profiles") allProfiles = true;
+            if (a == "--once" && !once) once = oneshot::Options{};
+            if (a == "--no-cache") onceCache = false;
+            if (a == "--watch") watch = true;
+            if (a == "--trace-startup"){
+                tracePath = (i+1 < argc && argv[i+1][0] != '-') ? std::string(argv[++i]) : std::string("al-muslim-trace.json");
+            }
+            if (a == "--format" && i+1 < argc){
+                once = oneshot::parse_format(argv[++i]);
+                if (!once){ std::cerr << "Usage: --format text|json|csv|<template>  e.g., --format '{next} {in}'\n"; return 1; }
+            }
+        }
+        if (tracePath){
+            if (!trace::kCompiledIn) std::cerr << "--trace-startup: this build has no tracing (configure with -DALMUSLIM_TRACE=ON)\n";
+            trace::enable(*tracePath);
+            // Early exits (one-shot commands, errors) still write what was recorded
+            std::atexit([]{ trace::finish(); });
+        }
+        if (once) return print_once(*once, onceCache);
+
+        // Parse the Hijri table (off-thread when it comes from a file) while config, onboarding and the banner run
+        std::future<bool> hjLoad = resources::load_hijri_async();
+        std::future<bool> hjReload; // refresh re-reads the table without blocking the prompt
+
+        if (hijriCheck){
+            if (!hjLoad.get()){ std::cerr << "No Umm al-Qura table found (built in or under a data directory)\n"; return 1; }
+            const std::pair<const char*, hijri::tabular::LeapPattern> patterns[] = {
+                {"kushyar", hijri::tabular::LeapPattern::Kushyar}, {"base16", hijri::tabular::LeapPattern::Base16},
+                {"fatimid", hijri::tabular::LeapPattern::Fatimid}, {"habash", hijri::tabular::LeapPattern::Habash}
+            };
+            int best = 1 << 30;
+            for (const auto &p : patterns){
+                int dev = hijri::max_tabular_deviation(p.second);
+                best = std::min(best, dev);
+                std::cout << p.first << ": max deviation " << dev << " day(s) over " << hijri::current()->rows() << " month starts\n";
+            }
+            // Umm al-Qura is sighting-adjusted; more than two days off means a bad table row
+            return best <= 2 ? 0 : 1;
         }
+
         // Resolve config path
+        ALMUSLIM_TRACE_SPAN(resolve, "config_resolve");
         fs::path config = platform::resolve_config_path();
-        std::unordered_map<std::string, std::string> cfg;
+        ALMUSLIM_TRACE_END(resolve);
+        // Parsed once; commands below update it in memory and write it back
+        settings::Store store(config);
+        const settings::Config &cfg = store.config();
         if (!config.empty() && fs::exists(config)) {
-            cfg = read_simple_kv(config);
+            std::vector<settings::ParseError> errors;
+            ALMUSLIM_TRACE_SPAN(parse, "read_config");
+            store.load(&errors);
+            ALMUSLIM_TRACE_END(parse);
+            for (const auto &e : errors) std::cerr << config.string() << ":" << e.line << ": " << e.message << "\n";
         } else {
             // First run onboarding
-            fs::path exeDir = fs::path(argv[0]).parent_path();
-            onboarding_wizard(config, exeDir);
-            if (fs::exists(config)) cfg = read_simple_kv(config);
+            onboarding_wizard(store);
         }
 
         // Setup mode to select city interactively and write config
         if (argc > 1 && std::string(argv[1]) == "--setup"){
-            fs::path exeDir = fs::path(argv[0]).parent_path();
-            fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-            if (!fs::exists(dataDir / "cities.csv")) {
-                fs::path sysData = "/usr/share/almuslim/data";
-                if (fs::exists(sysData / "cities.csv")) dataDir = sysData;
-            }
-#endif
-            auto cities = load_cities(dataDir);
+            const citydb::Index& cities = resources::cities();
             if (cities.empty()){
-                std::cout << "No cities database found at " << (dataDir/"cities.csv").string() << "\n";
+                std::cout << "No cities database found in " << resources::cities_source() << "\n";
                 return 1;
             }
             // Free-text input for more professional UX
             auto chosen = prompt_city_free_text(cities);
             if (!chosen){ std::cout << "Setup cancelled.\n"; return 0; }
-            const City &c = *chosen;
-            std::unordered_map<std::string,std::string> updates;
-            auto q = [](const std::string &s){ return '"' + s + '"'; };
-            updates["city"] = q(c.name + ", " + c.country);
-            updates["latitude"] = std::to_string(c.lat);
-            updates["longitude"] = std::to_string(c.lon);
-            updates["timezone"] = q(c.tz);
-            updates["method"] = q("umm_al_qura");
-            updates["madhab"] = q("shafi");
-            updates["high_latitude_rule"] = q("middle_of_the_night");
-            updates["24h"] = q("true");
-            write_or_update_config(config, updates);
-            std::cout << "Saved config to: " << config.string() << "\n";
+            set_location(store, *chosen);
+            store.set_string("method", "umm_al_qura");
+            store.set_string("madhab", "shafi");
+            store.set_string("high_latitude_rule", "middle_of_the_night");
+            store.set_bool("24h", true);
             // Continue to print today's times for chosen city
-            cfg = read_simple_kv(config);
+            if (save_config(store)) std::cout << "Saved config to: " << config.string() << "\n";
         }
 
-        // Resolve theme and language from config early (fallbacks below)
-        auto get_raw = [&](const std::string &k)->std::string{
-            auto it = cfg.find(k); return it==cfg.end()?std::string():it->second;
-        };
-    std::string lang = get_raw("language"); if (lang.empty()) lang = "en";
-    std::string colors = get_raw("colors"); if (colors.empty()) colors = "auto";
-    std::string fgS = get_raw("fg");
-    std::string bgS = get_raw("bg");
-    Theme theme = build_theme(colors, fgS, bgS);
+        if (allProfiles) return print_all_profiles(config, cfg);
+
+        // Hijri month grid joined with prayer times (one-shot, no banner or prompt)
+        if (hijriMonthArg){
+            int hy = 0, hm = 0;
+            if (std::sscanf(hijriMonthArg->c_str(), "%d-%d", &hy, &hm) != 2 || hm < 1 || hm > 12){
+                std::cerr << "Usage: --hijri-month <year>-<month>  e.g., --hijri-month 1448-09\n";
+                return 1;
+            }
+            hjLoad.wait();
+            bool fromTable = false;
+            auto grid = hijri::month_grid_any(hy, hm, &fromTable);
+            if (!fromTable) std::cerr << "Note: " << *hijriMonthArg << " is outside the Umm al-Qura table; using the tabular calendar (may differ by a day).\n";
+            const std::string &method = cfg.method, &madhab = cfg.madhab, &hlr = cfg.highLatRule;
+            bool use24h = cfg.use24h;
+            double latitude = cfg.latitude.value_or(0.0), longitude = cfg.longitude.value_or(0.0);
+            std::optional<double> tzOverride = prayer::parse_tz_hours(cfg.timezone);
+            std::cout << hijri::month_name_en(hm) << " " << hy << " AH (" << (cfg.city.empty() ? "(unset)" : cfg.city) << ")\n";
+            std::cout << "day,date,fajr,sunrise,dhuhr,asr,maghrib,isha\n";
+            for (const auto &d : grid){
+                std::tm dt{}; dt.tm_year = d.greg.year - 1900; dt.tm_mon = d.greg.month - 1; dt.tm_mday = d.greg.day;
+                char dstr[32]; std::snprintf(dstr, sizeof(dstr), "%04d-%02d-%02d", d.greg.year, d.greg.month, d.greg.day);
+                auto pt2 = prayer::compute_prayer_times(dt, latitude, longitude, method, madhab, hlr, tzOverride);
+                std::cout << d.hijri.day << "," << dstr;
+                if (pt2){
+                    std::cout << "," << prayer::fmt_time(pt2->fajr, use24h) << "," << prayer::fmt_time(pt2->sunrise, use24h)
+                              << "," << prayer::fmt_time(pt2->dhuhr, use24h) << "," << prayer::fmt_time(pt2->asr, use24h)
+                              << "," << prayer::fmt_time(pt2->maghrib, use24h) << "," << prayer::fmt_time(pt2->isha, use24h);
+                } else {
+                    std::cout << ",,,,,,";
+                }
+                std::cout << "\n";
+            }
+            return 0;
+        }
+
+        if (watch){
+            if (hjLoad.valid()) hjLoad.wait();
+            trace::finish();
+            return run_watch(config, store);
+        }
+
+        // Resolve theme from config early
+    ALMUSLIM_TRACE_SPAN(banner, "banner");
+    Theme theme = build_theme(cfg.colors, cfg.fg, cfg.bg);
+    const frame::Palette &e = theme.esc;
+    // The start screen is one frame, unless a city prompt splits it
+    frame::Writer &w = frame::screen();
 
     // Apply background/foreground if set
-    clear_screen();
-    apply_theme_colors(theme);
+    clear_screen(w);
+    apply_theme_colors(w, theme);
 
     // Professional header with ASCII rendition of the logo
-    std::cout << cstr(theme, "\x1b[32m"); // green
-        std::cout << "   ○○○○○   ○○○○   ○○○○○    Almuslim\n";
-        std::cout << "  ○      ○   ○   ○      ○   Fast Terminal Prayer Times\n";
-        std::cout << "  ○   ◐   ○   ○   ○   ★  ○   (C++)\n";
-        std::cout << "  ○      ○   ○   ○      ○\n";
-        std::cout << "   ○○○○○     ○     ○○○○○\n";
-    std::cout << creset(theme);
-    apply_theme_colors(theme);
-        std::cout << "Date/Time (local): " << now_local_iso() << "\n";
+    w << e.banner << kLogo << e.reset;
+    apply_theme_colors(w, theme);
+        w << "Date/Time (local): " << now_local_iso() << "\n";
         if (!config.empty()) {
-            std::cout << "Config: " << config.string() << (fs::exists(config)?" (found)":" (missing)") << "\n";
+            w << "Config: " << config.string() << (fs::exists(config)?" (found)":" (missing)") << "\n";
         }
 
-        // Read a few known keys (flat)
-        auto get = [&](const std::string &k, const std::string &def)->std::string{
-            auto it = cfg.find(k);
-            return it==cfg.end()?def:it->second;
-        };
-
-        std::string city = get("city", "(unset)");
-        std::string latS = get("latitude", "");
-        std::string lonS = get("longitude", "");
-        std::string method = get("method", "umm_al_qura");
-        std::string madhab = get("madhab", "shafi");
-    std::string hlr = get("high_latitude_rule", "middle_of_the_night");
-    std::string tzS = get("timezone", "");
-    std::string elevS = get("elevation_m", "");
-    bool use24h = true; { auto v = get("24h","true"); std::string s=v; std::transform(s.begin(),s.end(),s.begin(),::tolower); use24h = (s=="true"||s=="1"||s=="yes"); }
-    // ask_on_start in config (optional)
-    { auto v = get("ask_on_start","false"); std::string s=v; std::transform(s.begin(),s.end(),s.begin(),::tolower); if (s=="true"||s=="1"||s=="yes") askEveryLaunch = true; }
+        const std::string method = cfg.method, madhab = cfg.madhab, hlr = cfg.highLatRule;
+        bool use24h = cfg.use24h;
+        if (cfg.askOnStart) askEveryLaunch = true;
 
         // Ask for city each launch if requested or if not set
-        if (askEveryLaunch || city == "(unset)" || latS.empty() || lonS.empty()){
-            fs::path exeDir = fs::path(argv[0]).parent_path();
-            fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-            if (!fs::exists(dataDir / "cities.csv")) {
-                fs::path sysData = "/usr/share/almuslim/data";
-                if (fs::exists(sysData / "cities.csv")) dataDir = sysData;
-            }
-#endif
-            auto cities = load_cities(dataDir);
+        if (askEveryLaunch || cfg.city.empty() || !cfg.has_location()){
+            const citydb::Index& cities = resources::cities();
             if (!cities.empty()){
+                w.flush();
                 auto chosen = prompt_city_free_text(cities);
                 if (chosen){
-                    const City &c = *chosen;
-                    city = c.name + ", " + c.country;
-                    latS = std::to_string(c.lat);
-                    lonS = std::to_string(c.lon);
-                    tzS = c.tz;
-                    // persist
-                    std::unordered_map<std::string,std::string> updates;
-                    auto q = [](const std::string &s){ return '"' + s + '"'; };
-                    updates["city"] = q(city);
-                    updates["latitude"] = latS;
-                    updates["longitude"] = lonS;
-                    updates["timezone"] = q(tzS);
-                    write_or_update_config(config, updates);
+                    set_location(store, *chosen);
+                    save_config(store);
                 }
             }
         }
 
     // Labels (English/Arabic)
-    bool ar = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); ar = (L=="ar"||L=="arabic"); }
+    bool ar = cfg.arabic();
     auto Lbl = [&](const char* en, const char* arLabel){ return ar ? std::string(arLabel) : std::string(en); };
+    std::string city = cfg.city.empty() ? "(unset)" : cfg.city;
+    auto coord = [](std::optional<double> v){ if (!v) return std::string("(unset)"); std::ostringstream o; o << *v; return o.str(); };
+    std::string latS = coord(cfg.latitude), lonS = coord(cfg.longitude);
 
     if (!ar){
-      std::cout << Lbl("City", "المدينة") << ": " << city << "\n";
-      std::cout << Lbl("Latitude", "خط العرض") << ": " << (latS.empty()?"(unset)":latS) << ", "
-          << Lbl("Longitude", "خط الطول") << ": " << (lonS.empty()?"(unset)":lonS) << "\n";
-      std::cout << Lbl("Method", "الطريقة") << ": " << method << ", " << Lbl("Madhab", "المذهب") << ": " << madhab << "\n";
-      std::cout << Lbl("High-latitude", "خطوط العرض العليا") << ": " << hlr << "\n";
+      w << Lbl("City", "المدينة") << ": " << city << "\n";
+      w << Lbl("Latitude", "خط العرض") << ": " << latS << ", "
+          << Lbl("Longitude", "خط الطول") << ": " << lonS << "\n";
+      w << Lbl("Method", "الطريقة") << ": " << method << ", " << Lbl("Madhab", "المذهب") << ": " << madhab << "\n";
+      w << Lbl("High-latitude", "خطوط العرض العليا") << ": " << hlr << "\n";
     } else {
-      std::cout << rtl_wrap(Lbl("City", "المدينة") + std::string(": ") + city + "\n");
-      std::cout << rtl_wrap(Lbl("Latitude", "خط العرض") + std::string(": ") + (latS.empty()?"(unset)":latS) + ", "
-          + Lbl("Longitude", "خط الطول") + ": " + (lonS.empty()?"(unset)":lonS) + "\n");
-      std::cout << rtl_wrap(Lbl("Method", "الطريقة") + std::string(": ") + method + ", " + Lbl("Madhab", "المذهب") + ": " + madhab + "\n");
-      std::cout << rtl_wrap(Lbl("High-latitude", "خطوط العرض العليا") + std::string(": ") + hlr + "\n");
+      w << rtl_wrap(Lbl("City", "المدينة") + std::string(": ") + city + "\n");
+      w << rtl_wrap(Lbl("Latitude", "خط العرض") + std::string(": ") + latS + ", "
+          + Lbl("Longitude", "خط الطول") + ": " + lonS + "\n");
+      w << rtl_wrap(Lbl("Method", "الطريقة") + std::string(": ") + method + ", " + Lbl("Madhab", "المذهب") + ": " + madhab + "\n");
+      w << rtl_wrap(Lbl("High-latitude", "خطوط العرض العليا") + std::string(": ") + hlr + "\n");
     }
 
-        double latitude=0.0, longitude=0.0;
-        if (!latS.empty()) latitude = std::stod(latS);
-        if (!lonS.empty()) longitude = std::stod(lonS);
-        double elevation_m = 0.0; if (!elevS.empty()){
-            try { elevation_m = std::stod(elevS); } catch(...) { elevation_m = 0.0; }
-        }
-
-        using namespace std::chrono;
-        auto t = system_clock::to_time_t(system_clock::now());
-        std::tm lt{};
-#if defined(_WIN32)
-        localtime_s(&lt, &t);
-#else
-        localtime_r(&t, &lt);
-#endif
+        double latitude = cfg.latitude.value_or(0.0), longitude = cfg.longitude.value_or(0.0);
+        ALMUSLIM_TRACE_END(banner);
 
-        auto parse_tz_hours = [](const std::string &s)->std::optional<double>{
-            if (s.empty()) return std::nullopt;
-            std::string x = s; for(char &c: x) c = (char)std::tolower((unsigned char)c);
-            if (x=="utc" || x=="gmt" || x=="z") return 0.0;
-            if (x=="asia/riyadh" || x=="asia/makkah" || x=="asia/jeddah") return 3.0;
-            if (x.rfind("utc",0)==0) x = x.substr(3);
-            if (x.rfind("gmt",0)==0) x = x.substr(3);
-            x.erase(std::remove_if(x.begin(), x.end(), ::isspace), x.end());
-            if (x.empty()) return std::nullopt;
-            int sign = 1; size_t i=0; if (x[0]=='+'){sign=1;i=1;} else if (x[0]=='-'){sign=-1;i=1;}
-            size_t colon = x.find(':', i);
-            try{
-                if (colon==std::string::npos) { return sign * std::stod(x.substr(i)); }
-                double h = std::stod(x.substr(i, colon-i));
-                double m = std::stod(x.substr(colon+1));
-                return sign * (h + m/60.0);
-            } catch(...) { return std::nullopt; }
-        };
+        ALMUSLIM_TRACE_SPAN(compute, "compute");
+        zoneclock::ZoneClock &clk = zoneclock::ui_clock();
+        std::tm lt = clk.local_now();
+        double nowH = clk.hours_since_midnight();
 
-        std::optional<double> tzOverride = parse_tz_hours(tzS);
-        auto ptOpt = compute_prayer_times(lt, latitude, longitude, method, madhab, hlr, tzOverride);
+        std::optional<double> tzOverride = prayer::parse_tz_hours(cfg.timezone);
+        if (!tzOverride) tzOverride = clk.utc_offset_hours();
+        auto ptOpt = prayer::compute_prayer_times(lt, latitude, longitude, method, madhab, hlr, tzOverride);
+        ALMUSLIM_TRACE_END(compute);
         if (!ptOpt) {
-            std::cout << "\nUnable to compute prayer times for your location/date (high-latitude or invalid coords).\n";
+            w << "\nUnable to compute prayer times for your location/date (high-latitude or invalid coords).\n";
+            w.flush();
             return 0;
         }
-        PrayerTimes pt = *ptOpt;
+        prayer::PrayerTimes pt = *ptOpt;
 
         // Hijri date: prefer precise table if available
-    fs::path exeDir = fs::path(argv[0]).parent_path();
-    fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-    if (!fs::exists(dataDir / "hijri/umm_al_qura_month_starts.csv")) {
-        fs::path sysData = "/usr/share/almuslim/data";
-        if (fs::exists(sysData / "hijri/umm_al_qura_month_starts.csv")) dataDir = sysData;
-    }
-#endif
-    static bool hjLoaded = hijri::load_umm_al_qura(dataDir);
-        std::string hijriStr;
-        if (hjLoaded){
-            auto hd = hijri::hijri_for_date(lt);
-            if (hd){
-                bool ar = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); ar = (L=="ar"||L=="arabic"); }
-                const char* mname = ar ? hijri::month_name_ar(hd->month) : hijri::month_name_en(hd->month);
-                char buf[128]; std::snprintf(buf, sizeof(buf), "%d %s %d AH", hd->day, mname, hd->year);
-                hijriStr = buf;
-            }
-        }
-        if (hijriStr.empty()){
-            hijriStr = approx_hijri_date(lt);
+        if (hjLoad.valid()){
+            ALMUSLIM_TRACE_SCOPE("wait_umm_al_qura");
+            hjLoad.wait();
         }
+        ALMUSLIM_TRACE_SPAN(render, "render");
+        std::string hijriStr = hijri_display(lt, ar);
     if (ar) hijriStr = localize_digits_ar(hijriStr);
-    bool ar2 = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); ar2 = (L=="ar"||L=="arabic"); }
-    std::cout << "\n" << cstr(theme, "\x1b[36m") << (ar2 ? rtl_wrap(hijriStr) : hijriStr) << creset(theme) << "\n";
+    bool ar2 = cfg.arabic();
+    w << "\n" << e.hijri << (ar2 ? rtl_wrap(hijriStr) : hijriStr) << e.reset << "\n";
 
     // Fancy boxed table for prayers
     std::vector<std::string> names = {
@@ -952,25 +1100,25 @@ int main(int argc, char** argv) {
         Lbl("Asr","العصر"), Lbl("Maghrib","المغرب"), Lbl("Isha","العشاء")
     };
     std::vector<std::string> timesV = {
-        fmt_time(pt.fajr, use24h), fmt_time(pt.sunrise, use24h), fmt_time(pt.dhuhr, use24h),
-        fmt_time(pt.asr, use24h), fmt_time(pt.maghrib, use24h), fmt_time(pt.isha, use24h)
+        prayer::fmt_time(pt.fajr, use24h), prayer::fmt_time(pt.sunrise, use24h), prayer::fmt_time(pt.dhuhr, use24h),
+        prayer::fmt_time(pt.asr, use24h), prayer::fmt_time(pt.maghrib, use24h), prayer::fmt_time(pt.isha, use24h)
     };
     // Determine next prayer index for highlighting
     int nextIdx = -1;
     {
-        double nowHtmp = hours_since_midnight_local();
+        double nowHtmp = nowH;
         std::vector<double> seqH = {pt.fajr, pt.sunrise, pt.dhuhr, pt.asr, pt.maghrib, pt.isha};
         for (int i=0;i<(int)seqH.size();++i){ if (seqH[i] - nowHtmp >= -0.0001){ nextIdx = i; break; }}
         if (nextIdx < 0) nextIdx = 0; // wrap
     }
     {
-        std::string sum = std::string("") + cdim(theme) + Lbl("City","المدينة") + ": " + creset(theme) + city + "  "
-                        + cdim(theme) + Lbl("Method","الطريقة") + ": " + creset(theme) + method + " (" + madhab + ")\n";
-        bool arSum = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); arSum = (L=="ar"||L=="arabic"); }
-        std::cout << (arSum ? rtl_wrap(sum) : sum);
+        std::string sum = std::string("") + e.dim + Lbl("City","المدينة") + ": " + e.reset + city + "  "
+                        + e.dim + Lbl("Method","الطريقة") + ": " + e.reset + method + " (" + madhab + ")\n";
+        bool arSum = cfg.arabic();
+        w << (arSum ? rtl_wrap(sum) : sum);
     }
     if (ar){ for (auto &x: timesV) x = localize_digits_ar(x); }
-    draw_boxed_table(theme, names, timesV, nextIdx, ar);
+    draw_boxed_table(w, theme, names, timesV, nextIdx, ar);
 
         // Extra: Day length info
         double dayLenH = pt.maghrib - pt.sunrise; if (dayLenH < 0) dayLenH += 24.0;
@@ -979,11 +1127,10 @@ int main(int argc, char** argv) {
         char dBuf[32]; std::snprintf(dBuf, sizeof(dBuf), "%02d:%02d", std::max(0,dlh), std::max(0,dlm)); std::string dStr = dBuf; if (ar) dStr = localize_digits_ar(dStr);
         {
             std::string line = Lbl("Day length","طول النهار") + std::string(": ") + dStr + "\n";
-            std::cout << (ar ? rtl_wrap(line) : line);
+            w << (ar ? rtl_wrap(line) : line);
         }
 
         // Next prayer countdown
-        double nowH = hours_since_midnight_local();
         std::vector<std::pair<std::string,double>> seq = {
             {"Fajr", pt.fajr}, {"Sunrise", pt.sunrise}, {"Dhuhr", pt.dhuhr}, {"Asr", pt.asr}, {"Maghrib", pt.maghrib}, {"Isha", pt.isha}
         };
@@ -997,7 +1144,7 @@ int main(int argc, char** argv) {
         if (m==60){ h+=1; m=0; }
     char buf[32]; std::snprintf(buf, sizeof(buf), "%02d:%02d", std::max(0,h), std::max(0,m)); std::string nextStr = buf; if (ar) nextStr = localize_digits_ar(nextStr);
         // Progress bar: fraction until the next prayer relative to previous to next
-        double prevT = 0.0, nextT = 0.0, nowH2 = hours_since_midnight_local();
+        double prevT = 0.0, nextT = 0.0, nowH2 = nowH;
         {
             std::vector<std::pair<std::string,double>> seq2 = {
                 {"Fajr", pt.fajr}, {"Sunrise", pt.sunrise}, {"Dhuhr", pt.dhuhr}, {"Asr", pt.asr}, {"Maghrib", pt.maghrib}, {"Isha", pt.isha}
@@ -1012,44 +1159,49 @@ int main(int argc, char** argv) {
     if (ar){ if (nextName=="Fajr") nextName="الفجر"; else if (nextName=="Sunrise") nextName="الشروق"; else if (nextName=="Dhuhr") nextName="الظهر"; else if (nextName=="Asr") nextName="العصر"; else if (nextName=="Maghrib") nextName="المغرب"; else if (nextName=="Isha") nextName="العشاء"; }
     {
         std::string line = std::string("\n") + Lbl("Next","التالي") + " (" + nextName + ") " + Lbl("in","بعد") + ": " + nextStr + "  ";
-        std::cout << (ar ? rtl_wrap(line) : line);
+        w << (ar ? rtl_wrap(line) : line);
     }
-        draw_progress_bar(theme, frac);
-        std::cout << "\n";
+        draw_progress_bar(w, theme, progress_cells(frac));
+        w << "\n";
     {
-        bool arTip = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); arTip = (L=="ar"||L=="arabic"); }
+        bool arTip = cfg.arabic();
         std::string tipEn = "run with --setup for first-time setup, or --ask to choose a city on each launch.";
         std::string tipAr = "استخدم --setup للإعداد لأول مرة، أو --ask لاختيار المدينة عند كل تشغيل.";
         std::string line = Lbl("Tip","معلومة") + std::string(": ") + (arTip?tipAr:tipEn) + "\n";
-        std::cout << (arTip ? rtl_wrap(line) : line);
+        w << (arTip ? rtl_wrap(line) : line);
     }
+    w.flush();
 
     // Weekly schedule (one-shot)
     if (showWeek || weekCsvPath.has_value()) {
             std::cout << "\n" << Lbl("Next 7 days","السبعة أيام القادمة") << ":\n";
             std::cout << "---------------------------------------------\n";
             std::ofstream csv;
-            if (weekCsvPath){ csv.open(*weekCsvPath, std::ios::out | std::ios::trunc); if (csv) csv << "date,fajr,sunrise,dhuhr,asr,maghrib,isha\n"; }
+            if (weekCsvPath){ csv.open(*weekCsvPath, std::ios::out | std::ios::trunc); if (csv) csv << "date,fajr,sunrise,dhuhr,asr,maghrib,isha,hijri\n"; }
             for (int i=0;i<7;i++){
                 std::tm dt = add_days_local(lt, i);
-                auto pt2 = compute_prayer_times(dt, latitude, longitude, method, madhab, hlr, tzOverride);
+                auto pt2 = prayer::compute_prayer_times(dt, latitude, longitude, method, madhab, hlr, tzOverride);
                 if (!pt2) continue;
                 char dstr[32]; std::snprintf(dstr, sizeof(dstr), "%04d-%02d-%02d", dt.tm_year+1900, dt.tm_mon+1, dt.tm_mday);
                 std::cout << dstr << " | "
-                          << Lbl("Fajr","فجر") << ": " << fmt_time(pt2->fajr, use24h) << ", "
-                          << Lbl("Dhuhr","ظهر") << ": " << fmt_time(pt2->dhuhr, use24h) << ", "
-                          << Lbl("Asr","عصر") << ": " << fmt_time(pt2->asr, use24h) << ", "
-                          << Lbl("Maghrib","مغرب") << ": " << fmt_time(pt2->maghrib, use24h) << ", "
-                          << Lbl("Isha","عشاء") << ": " << fmt_time(pt2->isha, use24h)
+                          << Lbl("Fajr","فجر") << ": " << prayer::fmt_time(pt2->fajr, use24h) << ", "
+                          << Lbl("Dhuhr","ظهر") << ": " << prayer::fmt_time(pt2->dhuhr, use24h) << ", "
+                          << Lbl("Asr","عصر") << ": " << prayer::fmt_time(pt2->asr, use24h) << ", "
+                          << Lbl("Maghrib","مغرب") << ": " << prayer::fmt_time(pt2->maghrib, use24h) << ", "
+                          << Lbl("Isha","عشاء") << ": " << prayer::fmt_time(pt2->isha, use24h)
                           << "\n";
                 if (csv){
                     csv << dstr << ","
-                        << fmt_time(pt2->fajr, true) << ","
-                        << fmt_time(pt2->sunrise, true) << ","
-                        << fmt_time(pt2->dhuhr, true) << ","
-                        << fmt_time(pt2->asr, true) << ","
-                        << fmt_time(pt2->maghrib, true) << ","
-                        << fmt_time(pt2->isha, true) << "\n";
+                        << prayer::fmt_time(pt2->fajr, true) << ","
+                        << prayer::fmt_time(pt2->sunrise, true) << ","
+                        << prayer::fmt_time(pt2->dhuhr, true) << ","
+                        << prayer::fmt_time(pt2->asr, true) << ","
+                        << prayer::fmt_time(pt2->maghrib, true) << ","
+                        << prayer::fmt_time(pt2->isha, true) << ",";
+                    hijri::GregorianDate g; g.year = dt.tm_year+1900; g.month = dt.tm_mon+1; g.day = dt.tm_mday;
+                    hijri::HijriDate hd = hijri::hijri_for_gregorian_any(g);
+                    char hstr[24]; std::snprintf(hstr, sizeof(hstr), "%04d-%02d-%02d", hd.year, hd.month, hd.day);
+                    csv << hstr << "\n";
                 }
             }
             std::cout << "---------------------------------------------\n";
@@ -1058,9 +1210,9 @@ int main(int argc, char** argv) {
 
         // Interactive prompt for user-friendly commands
         auto print_help = [&](){
-            bool ar = false; { std::string L=lang; std::transform(L.begin(),L.end(),L.begin(),::tolower); ar = (L=="ar"||L=="arabic"); }
+            bool ar = cfg.arabic();
             if (!ar){
-                std::cout << "\nCommands: \n"
+                w << "\nCommands: \n"
                           << "  help            Show this help\n"
                           << "  setup           Run onboarding to select city and preferences\n"
                           << "  ask             Choose a city for this session only\n"
@@ -1071,7 +1223,7 @@ int main(int argc, char** argv) {
                           << "  refresh|r       Redraw and update now\n"
                           << "  quit|exit       Exit the app\n";
             } else {
-                auto out = [&](const std::string &s){ std::cout << rtl_wrap(s); };
+                auto out = [&](const std::string &s){ w << rtl_wrap(s); };
                 out("\nالأوامر:\n");
                 out("  help | مساعدة     عرض هذه المساعدة\n");
                 out("  setup | إعداد     تشغيل معالج الإعداد\n");
@@ -1083,69 +1235,79 @@ int main(int argc, char** argv) {
                 out("  refresh | تحديث   إعادة التحديث الآن\n");
                 out("  quit | exit | خروج  إنهاء التطبيق\n");
             }
+            w.flush();
+        };
+        // Edits made to the config outside the app (by hand, or a file pushed
+        // by a deployment tool) are applied while waiting at the prompt.
+        // render_main_view recomputes the times only if the location or
+        // calculation settings changed; other changes just redraw.
+        TodayTimes today;
+        platform::FileWatcher watcher(config);
+        auto apply_config_change = [&](){
+            settings::Config before = cfg;
+            std::vector<settings::ParseError> errors;
+            if (!store.reload(&errors)) return false;
+            for (const auto &e : errors) std::cerr << config.string() << ":" << e.line << ": " << e.message << "\n";
+            // The main view shows neither profiles nor the [updates]/[paths] settings
+            if (!(settings::diff(before, cfg) & ~unsigned(settings::ChangeProfiles | settings::ChangeOther))) return false;
+            render_main_view(config, cfg, today);
+            return true;
         };
         std::string cmd;
         print_help();
+        ALMUSLIM_TRACE_END(render);
+        // Startup ends at the first prompt
+        trace::finish();
         while (true){
-            std::cout << "\n> ";
+            std::cout << "\n> " << std::flush;
+            while (!watcher.wait_for_input()){
+                if (apply_config_change()) std::cout << "\n> " << std::flush;
+            }
             if (!std::getline(std::cin, cmd)) break;
             std::string c = cmd; for(char &ch: c) ch=(char)std::tolower((unsigned char)ch);
             if (c=="" || c=="help" || c=="h" || c=="?" || c=="" || c=="مساعدة"){
                 print_help();
             } else if (c=="setup" || c=="إعداد"){
-                fs::path exeDir = fs::path(argv[0]).parent_path();
-                onboarding_wizard(config, exeDir);
-                cfg = read_simple_kv(config);
-                render_main_view(argv[0], config, cfg);
+                onboarding_wizard(store);
+                render_main_view(config, cfg, today);
                 continue;
             } else if (c=="ask" || c=="اختيار"){
-                fs::path exeDir = fs::path(argv[0]).parent_path();
-                fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-                if (!fs::exists(dataDir / "cities.csv")) { fs::path sysData = "/usr/share/almuslim/data"; if (fs::exists(sysData / "cities.csv")) dataDir = sysData; }
-#endif
-                auto cities = load_cities(dataDir);
+                const citydb::Index& cities = resources::cities();
                 auto chosen = prompt_city_free_text(cities);
                 if (chosen){
-                    const City &c0 = *chosen;
-                    std::unordered_map<std::string,std::string> updates;
-                    auto q = [](const std::string &s){ return '"' + s + '"'; };
-                    updates["city"] = q(c0.name + ", " + c0.country);
-                    updates["latitude"] = std::to_string(c0.lat);
-                    updates["longitude"] = std::to_string(c0.lon);
-                    updates["timezone"] = q(c0.tz);
-                    write_or_update_config(config, updates);
-                    std::cout << "Saved city to config.\n";
-                    cfg = read_simple_kv(config);
-                    render_main_view(argv[0], config, cfg);
+                    set_location(store, *chosen);
+                    if (save_config(store)) std::cout << "Saved city to config.\n";
+                    render_main_view(config, cfg, today);
                     continue;
                 } else {
                     std::cout << "No match found. Type the city name to display anyway (or blank to cancel): ";
                     std::string cname; std::getline(std::cin, cname);
                     if (!cname.empty()){
-                        std::unordered_map<std::string,std::string> up2; auto q = [](const std::string &s){ return '"' + s + '"'; };
-                        up2["city"] = q(cname);
-                        write_or_update_config(config, up2);
-                        std::cout << "Saved custom city name.\n";
-                        cfg = read_simple_kv(config);
-                        render_main_view(argv[0], config, cfg);
+                        store.set_string("city", cname);
+                        if (save_config(store)) std::cout << "Saved custom city name.\n";
+                        render_main_view(config, cfg, today);
                         continue;
                     }
                 }
             } else if (c=="week" || c=="اسبوع"){
-                // Quick week reprint
+                // Quick week reprint, from the config as it is now (commands and reloads change it)
+                bool arW = cfg.arabic();
+                auto LblW = [&](const char* en, const char* arLabel){ return arW ? std::string(arLabel) : std::string(en); };
+                std::optional<double> tzW = prayer::parse_tz_hours(cfg.timezone);
+                if (!tzW) tzW = clk.utc_offset_hours();
                 std::cout << "\n---------------------------------------------\n";
                 for (int i=0;i<7;i++){
                     std::tm dt = add_days_local(lt, i);
-                    auto pt2 = compute_prayer_times(dt, latitude, longitude, method, madhab, hlr, tzOverride);
+                    auto pt2 = prayer::compute_prayer_times(dt, cfg.latitude.value_or(0.0), cfg.longitude.value_or(0.0),
+                                                            cfg.method, cfg.madhab, cfg.highLatRule, tzW);
                     if (!pt2) continue;
                     char dstr[32]; std::snprintf(dstr, sizeof(dstr), "%04d-%02d-%02d", dt.tm_year+1900, dt.tm_mon+1, dt.tm_mday);
                     std::cout << dstr << " | "
-                              << Lbl("Fajr","فجر") << ": " << fmt_time(pt2->fajr, use24h) << ", "
-                              << Lbl("Dhuhr","ظهر") << ": " << fmt_time(pt2->dhuhr, use24h) << ", "
-                              << Lbl("Asr","عصر") << ": " << fmt_time(pt2->asr, use24h) << ", "
-                              << Lbl("Maghrib","مغرب") << ": " << fmt_time(pt2->maghrib, use24h) << ", "
-                              << Lbl("Isha","عشاء") << ": " << fmt_time(pt2->isha, use24h)
+                              << LblW("Fajr","فجر") << ": " << prayer::fmt_time(pt2->fajr, cfg.use24h) << ", "
+                              << LblW("Dhuhr","ظهر") << ": " << prayer::fmt_time(pt2->dhuhr, cfg.use24h) << ", "
+                              << LblW("Asr","عصر") << ": " << prayer::fmt_time(pt2->asr, cfg.use24h) << ", "
+                              << LblW("Maghrib","مغرب") << ": " << prayer::fmt_time(pt2->maghrib, cfg.use24h) << ", "
+                              << LblW("Isha","عشاء") << ": " << prayer::fmt_time(pt2->isha, cfg.use24h)
                               << "\n";
                 }
                 std::cout << "---------------------------------------------\n";
@@ -1156,87 +1318,67 @@ int main(int argc, char** argv) {
                 if (g){
                     double la, lo; std::string tzV, cityV, countryV; std::tie(la,lo,tzV,cityV,countryV) = *g;
                     // Try to snap to a known city from our database for better accuracy
-                    fs::path exeDir = fs::path(argv[0]).parent_path();
-                    fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-                    if (!fs::exists(dataDir / "cities.csv")) { fs::path sysData = "/usr/share/almuslim/data"; if (fs::exists(sysData / "cities.csv")) dataDir = sysData; }
-#endif
-                    auto cities = load_cities(dataDir);
+                    const citydb::Index& cities = resources::cities();
                     auto lower = [](std::string s){ for(char &c: s) c=(char)std::tolower((unsigned char)c); return s; };
-                    std::string q = cityV; if (!countryV.empty()) q += ", " + countryV;
-                    std::string ql = lower(q);
-                    // Synonym fixes (common transliterations)
-                    if (ql.find("buraydah")!=std::string::npos) q = "Buraidah, Saudi Arabia";
-                    if (ql.find("mecca")!=std::string::npos) q = "Makkah, Saudi Arabia";
-                    if (ql.find("medina")!=std::string::npos) q = "Madinah, Saudi Arabia";
+                    // Nearest city to the IP position; the reported name is only a fallback
                     std::optional<City> snap;
-                    if (!cities.empty()) snap = find_best_city_match(cities, q);
-                    std::unordered_map<std::string,std::string> updates;
-                    auto qstr = [](const std::string &s){ return '"' + s + '"'; };
+                    auto near = cities.nearest(la, lo, 1, kSnapRadiusKm);
+                    if (!near.empty()) snap = cities.city(near[0].city);
+                    if (!snap && !cities.empty()){
+                        std::string q = cityV; if (!countryV.empty()) q += ", " + countryV;
+                        snap = find_best_city_match(cities, q);
+                    }
+                    bool snapped = false;
                     if (snap){
                         const City &c0 = *snap;
                         std::cout << "Matched to database city: " << c0.name << ", " << c0.country << " (" << c0.lat << ", " << c0.lon << ") tz: " << c0.tz << "\n";
                         std::cout << "Use this match? [Y/n]: ";
                         std::string ans; std::getline(std::cin, ans); std::string al = lower(ans);
                         bool use = (ans.empty() || al=="y" || al=="yes");
-                        if (use){
-                            updates["city"] = qstr(c0.name + ", " + c0.country);
-                            updates["latitude"] = std::to_string(c0.lat);
-                            updates["longitude"] = std::to_string(c0.lon);
-                            updates["timezone"] = qstr(c0.tz);
-                        }
+                        if (use){ set_location(store, c0); snapped = true; }
                     }
                     // If no snap or user chose not to use it, persist raw IP values
-                    if (updates.empty()){
-                        updates["latitude"] = std::to_string(la);
-                        updates["longitude"] = std::to_string(lo);
-                        if (!tzV.empty()) updates["timezone"] = qstr(tzV);
+                    if (!snapped){
+                        store.set_number("latitude", la);
+                        store.set_number("longitude", lo);
+                        if (!tzV.empty()) store.set_string("timezone", tzV);
                         if (!cityV.empty()) {
                             std::string full = cityV; if (!countryV.empty()) full += ", " + countryV;
-                            updates["city"] = qstr(full);
+                            store.set_string("city", full);
                         }
                         // Country fallback TZ if missing
-                        if (tzV.empty() && lower(countryV)=="saudi arabia") updates["timezone"] = qstr("Asia/Riyadh");
+                        if (tzV.empty() && lower(countryV)=="saudi arabia") store.set_string("timezone", "Asia/Riyadh");
                     }
-                    write_or_update_config(config, updates);
-                    std::cout << "Saved location to config.\n";
+                    if (save_config(store)) std::cout << "Saved location to config.\n";
                     // Offer to set a custom display city string; if it matches our DB, also update coords/timezone
                     std::cout << "Enter a custom city name to display (or blank to keep): ";
                     std::string cname; std::getline(std::cin, cname);
                     if (!cname.empty()){
-                        std::unordered_map<std::string,std::string> up2; up2["city"] = '"' + cname + '"';
+                        store.set_string("city", cname);
                         // Attempt to match this custom name to our database for more accurate coordinates
-                        fs::path exeDir2 = fs::path(argv[0]).parent_path();
-                        fs::path dataDir2 = exeDir2 / "data";
-#if !defined(_WIN32)
-                        if (!fs::exists(dataDir2 / "cities.csv")) { fs::path sysData2 = "/usr/share/almuslim/data"; if (fs::exists(sysData2 / "cities.csv")) dataDir2 = sysData2; }
-#endif
-                        auto cities2 = load_cities(dataDir2);
-                        auto m = find_best_city_match(cities2, cname);
+                        auto m = find_best_city_match(cities, cname);
                         if (m){
                             const City &cx = *m;
-                            up2["city"] = '"' + (cx.name + ", " + cx.country) + '"';
-                            up2["latitude"] = std::to_string(cx.lat);
-                            up2["longitude"] = std::to_string(cx.lon);
-                            up2["timezone"] = '"' + cx.tz + '"';
+                            set_location(store, cx);
                             std::cout << "Matched and applied: " << cx.name << ", " << cx.country << " (" << cx.lat << ", " << cx.lon << ") tz: " << cx.tz << "\n";
                         }
-                        write_or_update_config(config, up2);
-                        std::cout << "Saved custom city.\n";
+                        if (save_config(store)) std::cout << "Saved custom city.\n";
                     }
-                    cfg = read_simple_kv(config);
-                    render_main_view(argv[0], config, cfg);
+                    render_main_view(config, cfg, today);
                     continue;
                 } else {
                     std::cout << "Could not detect location.\n";
                 }
-            } else if (c=="refresh" || c=="r" || c=="تحديث"){
-                cfg = read_simple_kv(config);
-                render_main_view(argv[0], config, cfg);
-                continue;
 #else
                 std::cout << "Location detection currently supported on Windows only.\n";
 #endif
+            } else if (c=="refresh" || c=="r" || c=="تحديث"){
+                if (!hjReload.valid() || hjReload.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    hjReload = resources::load_hijri_async();
+                // Pick up edits made to the file outside the app
+                store.load();
+                render_main_view(config, cfg, today);
+                continue;
             } else if (c.rfind("coords",0)==0 || c.rfind("إحداثيات",0)==0){
                 // Usage: coords <lat> <lon> [timezone]
                 std::istringstream iss(cmd);
@@ -1249,14 +1391,22 @@ int main(int argc, char** argv) {
                 } else {
                     try{
                         double la = std::stod(sLat); double lo = std::stod(sLon);
-                        std::unordered_map<std::string,std::string> up;
-                        up["latitude"] = std::to_string(la);
-                        up["longitude"] = std::to_string(lo);
-                        if (!sTz.empty()) up["timezone"] = '"' + sTz + '"';
-                        write_or_update_config(config, up);
-                        std::cout << "Coordinates saved.\n";
-                        cfg = read_simple_kv(config);
-                        render_main_view(argv[0], config, cfg);
+                        store.set_number("latitude", la);
+                        store.set_number("longitude", lo);
+                        if (!sTz.empty()) store.set_string("timezone", sTz);
+                        // Name the place (and fill in its timezone) from the nearest known city
+                        const citydb::Index& cities = resources::cities();
+                        auto near = cities.nearest(la, lo, 1, kSnapRadiusKm);
+                        if (!near.empty()){
+                            uint32_t ci = near[0].city;
+                            store.set_string("city", std::string(cities.name(ci)) + ", " + std::string(cities.country(ci)));
+                            if (sTz.empty()) store.set_string("timezone", cities.tz(ci));
+                            std::cout << "Nearest city: " << cities.name(ci) << ", " << cities.country(ci)
+                                      << " (" << std::fixed << std::setprecision(1) << near[0].km << " km) tz: " << cities.tz(ci) << "\n";
+                            std::cout.unsetf(std::ios::fixed);
+                        }
+                        if (save_config(store)) std::cout << "Coordinates saved.\n";
+                        render_main_view(config, cfg, today);
                         continue;
                     } catch(...){ std::cout << "Invalid numbers.\n"; }
                 }
@@ -1268,25 +1418,13 @@ int main(int argc, char** argv) {
                 if (name.empty()){
                     std::cout << "Usage: city <name>   e.g., city Buraidah\n";
                 } else {
-                    fs::path exeDir = fs::path(argv[0]).parent_path();
-                    fs::path dataDir = exeDir / "data";
-#if !defined(_WIN32)
-                    if (!fs::exists(dataDir / "cities.csv")) { fs::path sysData = "/usr/share/almuslim/data"; if (fs::exists(sysData / "cities.csv")) dataDir = sysData; }
-#endif
-                    auto cities = load_cities(dataDir);
-                    auto m = find_best_city_match(cities, name);
-                    if (m){
-                        const City &c0 = *m;
-                        std::unordered_map<std::string,std::string> up;
-                        auto q = [](const std::string &s){ return '"' + s + '"'; };
-                        up["city"] = q(c0.name + ", " + c0.country);
-                        up["latitude"] = std::to_string(c0.lat);
-                        up["longitude"] = std::to_string(c0.lon);
-                        up["timezone"] = q(c0.tz);
-                        write_or_update_config(config, up);
-                        std::cout << "City updated.\n";
-                        cfg = read_simple_kv(config);
-                        render_main_view(argv[0], config, cfg);
+                    const citydb::Index& cities = resources::cities();
+                    std::vector<CityMatch> hits = search_cities(cities, name, 4);
+                    if (!hits.empty()){
+                        set_location(store, cities.city(hits[0].city));
+                        if (save_config(store)) std::cout << "City updated.\n";
+                        render_main_view(config, cfg, today);
+                        print_other_matches(cities, hits);
                         continue;
                     } else {
                         std::cout << "No matching city found in database.\n";
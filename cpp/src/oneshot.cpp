@@ -0,0 +1,159 @@
+#include "oneshot.hpp"
+#include "hijri.hpp"
+#include "prayer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace oneshot {
+
+static const char* const kKeys[6] = {"fajr", "sunrise", "dhuhr", "asr", "maghrib", "isha"};
+static const char* const kNamesEn[6] = {"Fajr", "Sunrise", "Dhuhr", "Asr", "Maghrib", "Isha"};
+static const char* const kNamesAr[6] = {"الفجر", "الشروق", "الظهر", "العصر", "المغرب", "العشاء"};
+
+std::optional<Options> parse_format(std::string_view s){
+    Options opt;
+    if (s == "text") opt.format = Format::Text;
+    else if (s == "json") opt.format = Format::Json;
+    else if (s == "csv") opt.format = Format::Csv;
+    else if (s.find('{') != std::string_view::npos){ opt.format = Format::Template; opt.tmpl = std::string(s); }
+    else return std::nullopt;
+    return opt;
+}
+
+bool needs_hijri(const Options& opt){
+    switch (opt.format){
+        case Format::Text:
+        case Format::Json: return true;
+        case Format::Csv: return false;
+        case Format::Template: return opt.tmpl.find("{hijri}") != std::string::npos;
+    }
+    return false;
+}
+
+std::optional<Day> compute_day(const settings::Config& cfg, const std::tm& date,
+                               double localOffsetHours, bool withHijri){
+    std::optional<double> tz = prayer::parse_tz_hours(cfg.timezone);
+    auto pt = prayer::compute_prayer_times(date, cfg.latitude.value_or(0.0), cfg.longitude.value_or(0.0),
+                                           cfg.method, cfg.madhab, cfg.highLatRule, tz.value_or(localOffsetHours));
+    if (!pt) return std::nullopt;
+    Day d;
+    char buf[32]; std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", date.tm_year + 1900, date.tm_mon + 1, date.tm_mday);
+    d.date = buf;
+    d.city = cfg.city;
+    d.arabic = cfg.arabic();
+    const double h[6] = { pt->fajr, pt->sunrise, pt->dhuhr, pt->asr, pt->maghrib, pt->isha };
+    for (int i=0;i<6;++i){
+        d.hours[i] = h[i];
+        d.times[i] = prayer::fmt_time(h[i], cfg.use24h);
+    }
+    if (withHijri){
+        hijri::GregorianDate g; g.year = date.tm_year + 1900; g.month = date.tm_mon + 1; g.day = date.tm_mday;
+        d.hijri = hijri::display_date(g, cfg.arabic());
+    }
+    return d;
+}
+
+// The next entry at or after nowH and the time until it as "HH:MM". After
+// Isha that is Fajr of `tomorrow` (or today's Fajr again, without it), and
+// `next` is set to the day it belongs to.
+static int next_prayer(const Day& d, const Day* tomorrow, double nowH, std::string& in, const Day*& next){
+    int idx = 0;
+    next = tomorrow ? tomorrow : &d;
+    double dt = 24.0 - nowH + next->hours[0];
+    for (int i=0;i<6;++i){
+        if (d.hours[i] - nowH >= -0.0001){ idx = i; dt = d.hours[i] - nowH; next = &d; break; }
+    }
+    int h = (int)std::floor(dt + 1e-9); int m = (int)std::floor((dt - h)*60.0 + 0.5); if (m==60){ h+=1; m=0; }
+    char buf[32]; std::snprintf(buf, sizeof(buf), "%02d:%02d", std::max(0,h), std::max(0,m));
+    in = buf;
+    return idx;
+}
+
+static void append_json_string(std::string& out, std::string_view s){
+    out.push_back('"');
+    for (char c : s){
+        if (c=='"' || c=='\\'){ out.push_back('\\'); out.push_back(c); }
+        else if ((unsigned char)c < 0x20) out.push_back(' ');
+        else out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// Terminal columns taken by UTF-8 text (one per code point)
+static size_t text_width(std::string_view s){
+    size_t w = 0;
+    for (unsigned char ch : s) if ((ch & 0xC0) != 0x80) ++w;
+    return w;
+}
+
+void format(const Options& opt, const Day& today, const Day* tomorrow, double nowH, std::string& out){
+    const bool ar = today.arabic;
+    const char* const* names = ar ? kNamesAr : kNamesEn;
+    std::string in;
+    const Day* nextDay = nullptr;
+    int next = next_prayer(today, tomorrow, nowH, in, nextDay);
+    const std::string& nextTime = nextDay->times[next];
+    switch (opt.format){
+    case Format::Text: {
+        out += today.date;
+        if (!today.hijri.empty()){ out += "  "; out += today.hijri; }
+        out += '\n';
+        if (!today.city.empty()){ out += today.city; out += '\n'; }
+        for (int i=0;i<6;++i){
+            out += names[i];
+            out.append(9 - std::min<size_t>(8, text_width(names[i])), ' ');
+            out += today.times[i];
+            out += '\n';
+        }
+        out += ar ? "التالي" : "Next"; out += ": "; out += names[next];
+        out += ar ? " بعد " : " in "; out += in; out += '\n';
+        break;
+    }
+    case Format::Json: {
+        out += "{\"date\":\""; out += today.date; out += '"';
+        if (!today.hijri.empty()){ out += ",\"hijri\":"; append_json_string(out, today.hijri); }
+        out += ",\"city\":"; append_json_string(out, today.city);
+        for (int i=0;i<6;++i){ out += ",\""; out += kKeys[i]; out += "\":\""; out += today.times[i]; out += '"'; }
+        out += ",\"next\":\""; out += kKeys[next];
+        out += "\",\"next_time\":\""; out += nextTime;
+        out += "\",\"next_in\":\""; out += in; out += "\"}\n";
+        break;
+    }
+    case Format::Csv: {
+        out += "date,fajr,sunrise,dhuhr,asr,maghrib,isha,next,next_in\n";
+        out += today.date;
+        for (int i=0;i<6;++i){ out += ','; out += today.times[i]; }
+        out += ','; out += kKeys[next]; out += ','; out += in; out += '\n';
+        break;
+    }
+    case Format::Template: {
+        std::string_view t = opt.tmpl;
+        while (!t.empty()){
+            size_t open = t.find('{');
+            size_t close = open == std::string_view::npos ? open : t.find('}', open);
+            if (close == std::string_view::npos){ out.append(t.data(), t.size()); break; }
+            out.append(t.data(), open);
+            std::string_view key = t.substr(open + 1, close - open - 1);
+            bool known = true;
+            if (key == "date") out += today.date;
+            else if (key == "hijri") out += today.hijri;
+            else if (key == "city") out += today.city;
+            else if (key == "next") out += names[next];
+            else if (key == "next_time") out += nextTime;
+            else if (key == "in") out += in;
+            else {
+                known = false;
+                for (int i=0;i<6;++i) if (key == kKeys[i]){ out += today.times[i]; known = true; break; }
+            }
+            if (!known) out.append(t.data() + open, close - open + 1);
+            t.remove_prefix(close + 1);
+        }
+        out += '\n';
+        break;
+    }
+    }
+}
+
+} // namespace oneshot
@@ -0,0 +1,48 @@
+#pragma once
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "settings.hpp"
+
+// --once / --format: today's times as one block of text for status bars
+// (tmux, polybar, waybar), cron jobs and scripts. No banner, no prompt, no
+// colors; the caller writes the result to stdout in one go.
+namespace oneshot {
+
+enum class Format { Text, Json, Csv, Template };
+
+struct Options {
+    Format format = Format::Text;
+    std::string tmpl;           // Format::Template: text with {placeholders}
+};
+
+// "text", "json", "csv", or a template such as "{next} {in}". Placeholders:
+// {date} {hijri} {city} {fajr} {sunrise} {dhuhr} {asr} {maghrib} {isha}
+// {next} (prayer name) {next_time} {in} (HH:MM until it). Unknown ones are
+// copied as written. std::nullopt for an unknown name without braces.
+std::optional<Options> parse_format(std::string_view s);
+
+// Whether the output shows the Hijri date, i.e. the table has to be loaded
+bool needs_hijri(const Options& opt);
+
+// Everything shown for one date, computed once (and cached by daycache)
+struct Day {
+    std::string date;           // YYYY-MM-DD
+    std::string hijri;          // empty unless asked for
+    std::string city;
+    bool arabic = false;        // Arabic labels and Hijri month names
+    double hours[6] = {};       // fajr, sunrise, dhuhr, asr, maghrib, isha (local hours)
+    std::string times[6];       // the same, formatted for the config's clock
+};
+
+// std::nullopt if the times cannot be computed (e.g. polar day)
+std::optional<Day> compute_day(const settings::Config& cfg, const std::tm& date,
+                               double localOffsetHours, bool withHijri);
+
+// Append the output for `nowH` (local hours since midnight) to `out`. After
+// Isha the countdown runs to tomorrow's Fajr, taken from `tomorrow` when given.
+void format(const Options& opt, const Day& today, const Day* tomorrow, double nowH, std::string& out);
+
+} // namespace oneshot
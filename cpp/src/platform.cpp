@@ -1,13 +1,38 @@
 #include "platform.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <cstdlib>
+#include <fstream>
+#include <utility>
 #include <filesystem>
 #include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <conio.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
 namespace platform {
 
-static fs::path home_dir() {
+fs::path home_dir() {
 #if defined(_WIN32)
     const char* userprofile = std::getenv("USERPROFILE");
     if (userprofile) return fs::path(userprofile);
@@ -21,6 +46,40 @@ static fs::path home_dir() {
 #endif
 }
 
+fs::path executable_path() {
+#if defined(_WIN32)
+    std::wstring buf(MAX_PATH, L'\0');
+    for (;;) {
+        DWORD n = GetModuleFileNameW(nullptr, buf.data(), (DWORD)buf.size());
+        if (n == 0) return {};
+        if (n < buf.size()) { buf.resize(n); return fs::path(buf); }
+        buf.resize(buf.size() * 2);
+    }
+#elif defined(__APPLE__)
+    uint32_t size = 0;
+    _NSGetExecutablePath(nullptr, &size);
+    std::string buf(size, '\0');
+    if (_NSGetExecutablePath(buf.data(), &size) != 0) return {};
+    std::error_code ec;
+    fs::path p = fs::canonical(buf.c_str(), ec);
+    return ec ? fs::path(buf.c_str()) : p;
+#else
+    std::error_code ec;
+    fs::path p = fs::read_symlink("/proc/self/exe", ec);
+    return ec ? fs::path() : p;
+#endif
+}
+
+fs::path cache_dir() {
+#if defined(_WIN32)
+    if (const char* local = std::getenv("LOCALAPPDATA"); local && *local) return fs::path(local) / "almuslim" / "cache";
+    return home_dir() / ".al-muslim" / "cache";
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) return fs::path(xdg) / "almuslim";
+    return home_dir() / ".cache" / "almuslim";
+#endif
+}
+
 fs::path resolve_config_path() {
     // Respect override env var first
     if (const char* env = std::getenv("ALMUSLIM_CONFIG")) {
@@ -38,4 +97,359 @@ fs::path resolve_config_path() {
 #endif
 }
 
+MappedFile::~MappedFile(){ close(); }
+
+MappedFile::MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if (this != &o){
+        close();
+        std::swap(data_, o.data_); std::swap(size_, o.size_); std::swap(mapped_, o.mapped_);
+#if defined(_WIN32)
+        std::swap(file_, o.file_); std::swap(mapping_, o.mapping_);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const fs::path& p){
+    close();
+#if defined(_WIN32)
+    HANDLE f = CreateFileW(p.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f != INVALID_HANDLE_VALUE){
+        LARGE_INTEGER sz; 
+        if (GetFileSizeEx(f, &sz) && sz.QuadPart > 0){
+            HANDLE m = CreateFileMappingW(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m){
+                void* v = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+                if (v){
+                    data_ = static_cast<const char*>(v); size_ = (size_t)sz.QuadPart; mapped_ = true;
+                    file_ = f; mapping_ = m;
+                    return true;
+                }
+                CloseHandle(m);
+            }
+        }
+        CloseHandle(f);
+    }
+#else
+    int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0){
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0){
+            void* v = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (v != MAP_FAILED){
+                ::close(fd);
+                data_ = static_cast<const char*>(v); size_ = (size_t)st.st_size; mapped_ = true;
+                return true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+    // Fallback: plain read
+    std::ifstream in(p, std::ios::binary);
+    if (!in) return false;
+    in.seekg(0, std::ios::end);
+    std::streamoff n = in.tellg();
+    if (n <= 0) return false;
+    in.seekg(0, std::ios::beg);
+    char* buf = new char[(size_t)n];
+    if (!in.read(buf, n)){ delete[] buf; return false; }
+    data_ = buf; size_ = (size_t)n; mapped_ = false;
+    return true;
+}
+
+void MappedFile::close(){
+    if (!data_) return;
+    if (mapped_){
+#if defined(_WIN32)
+        UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle((HANDLE)mapping_);
+        if (file_) CloseHandle((HANDLE)file_);
+        mapping_ = nullptr; file_ = nullptr;
+#else
+        ::munmap(const_cast<char*>(data_), size_);
+#endif
+    } else {
+        delete[] data_;
+    }
+    data_ = nullptr; size_ = 0; mapped_ = false;
+}
+
+bool write_file_atomic(const fs::path& p, std::string_view data, std::string* err, bool durable){
+    // A temp name of our own next to the target, so concurrent writers never
+    // share (or delete) each other's temp file
+    fs::path tmp = p;
+#if defined(_WIN32)
+    tmp += "." + std::to_string(GetCurrentProcessId()) + "." + std::to_string(GetCurrentThreadId()) + ".tmp";
+#else
+    tmp += ".XXXXXX";
+#endif
+    auto fail = [&](const std::string& what){ if (err) *err = what + " " + tmp.string(); std::error_code ec; fs::remove(tmp, ec); return false; };
+#if defined(_WIN32)
+    HANDLE h = CreateFileW(tmp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE){ if (err) *err = "cannot write " + tmp.string(); return false; }
+    size_t done = 0;
+    while (done < data.size()){
+        DWORD n = 0;
+        DWORD chunk = (DWORD)std::min<size_t>(data.size() - done, 1u << 30);
+        if (!WriteFile(h, data.data() + done, chunk, &n, nullptr) || n == 0){ CloseHandle(h); return fail("short write to"); }
+        done += n;
+    }
+    bool flushed = !durable || FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+    if (!flushed) return fail("cannot flush");
+    if (!MoveFileExW(tmp.c_str(), p.c_str(), MOVEFILE_REPLACE_EXISTING | (durable ? MOVEFILE_WRITE_THROUGH : 0))) return fail("cannot rename");
+#else
+    // Keep the permissions of the file being replaced (a config may be 0600)
+    struct stat st;
+    mode_t mode = ::stat(p.c_str(), &st) == 0 ? (st.st_mode & 07777) : 0644;
+    std::string tmpName = tmp.string();
+    int fd = ::mkstemp(tmpName.data());
+    if (fd < 0){ if (err) *err = "cannot write " + tmp.string(); return false; }
+    tmp = tmpName;
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    ::fchmod(fd, mode);
+    size_t done = 0;
+    while (done < data.size()){
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0){ ::close(fd); return fail("short write to"); }
+        done += (size_t)n;
+    }
+    if (durable && ::fsync(fd) != 0){ ::close(fd); return fail("cannot sync"); }
+    if (::close(fd) != 0) return fail("cannot close");
+    if (::rename(tmp.c_str(), p.c_str()) != 0) return fail("cannot rename");
+    if (!durable) return true;
+    // Make the rename itself durable
+    fs::path dir = p.parent_path().empty() ? fs::path(".") : p.parent_path();
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0){ ::fsync(dfd); ::close(dfd); }
+#endif
+    return true;
+}
+
+bool write_stdout(std::string_view data){
+#if defined(_WIN32)
+    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+    size_t done = 0;
+    while (done < data.size()){
+        DWORD n = 0;
+        DWORD chunk = (DWORD)std::min<size_t>(data.size() - done, 1u << 30);
+        if (!WriteFile(h, data.data() + done, chunk, &n, nullptr) || n == 0) return false;
+        done += n;
+    }
+#else
+    size_t done = 0;
+    while (done < data.size()){
+        ssize_t n = ::write(STDOUT_FILENO, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += (size_t)n;
+    }
+#endif
+    return true;
+}
+
+// How often the fallback compares the file's stamp
+static constexpr std::chrono::milliseconds kPollInterval{2000};
+
+FileWatcher::FileWatcher(fs::path p) : path_(std::move(p)) {
+    stamp_changed();
+#if defined(__linux__)
+    fs::path dir = path_.parent_path().empty() ? fs::path(".") : path_.parent_path();
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Whole-file writes and renames into the directory; a watch on the file
+    // itself would be lost when it is replaced
+    if (fd_ >= 0 && ::inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher(){
+#if !defined(_WIN32)
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+bool FileWatcher::drain_events(){
+    bool hit = false;
+#if defined(__linux__)
+    std::string name = path_.filename().string();
+    alignas(struct inotify_event) char buf[4096];
+    for (;;){
+        ssize_t n = ::read(fd_, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char* p = buf; p < buf + n;){
+            const auto* ev = reinterpret_cast<const struct inotify_event*>(p);
+            if (ev->len && name == ev->name) hit = true;
+            if (ev->mask & IN_IGNORED){
+                // The directory went away: fall back to polling
+                ::close(fd_);
+                fd_ = -1;
+                return hit;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+#endif
+    return hit;
+}
+
+bool FileWatcher::stamp_changed(){
+    std::error_code ec;
+    auto mtime = fs::last_write_time(path_, ec);
+    if (ec) return false;
+    uintmax_t size = fs::file_size(path_, ec);
+    if (ec) return false;
+    bool diff = mtime != mtime_ || size != size_;
+    mtime_ = mtime;
+    size_ = size;
+    return diff;
+}
+
+bool FileWatcher::changed(){
+    if (fd_ >= 0) return drain_events();
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextPoll_) return false;
+    nextPoll_ = now + kPollInterval;
+    return stamp_changed();
+}
+
+bool FileWatcher::wait_for_input(){
+#if defined(_WIN32)
+    if (!_isatty(_fileno(stdin))) return !changed();
+    HANDLE in = GetStdHandle(STD_INPUT_HANDLE);
+    for (;;){
+        if (WaitForSingleObject(in, (DWORD)kPollInterval.count()) == WAIT_OBJECT_0){
+            // Focus and mouse events also wake the handle; only a key press counts
+            INPUT_RECORD rec; DWORD n = 0;
+            while (PeekConsoleInputW(in, &rec, 1, &n) && n == 1
+                   && !(rec.EventType == KEY_EVENT && rec.Event.KeyEvent.bKeyDown)){
+                ReadConsoleInputW(in, &rec, 1, &n);
+                n = 0;
+            }
+            if (n) return true;
+        }
+        if (changed()) return false;
+    }
+#else
+    if (!::isatty(STDIN_FILENO)) return !changed();
+    for (;;){
+        struct pollfd p[2] = {{STDIN_FILENO, POLLIN, 0}, {fd_, POLLIN, 0}};
+        bool native = fd_ >= 0;
+        int n = ::poll(p, native ? 2 : 1, native ? -1 : (int)kPollInterval.count());
+        if (n < 0 && errno != EINTR) return true;
+        if (n > 0 && p[0].revents) return true;
+        if (changed()) return false;
+    }
+#endif
+}
+
+#if defined(_WIN32)
+RawTerminal::RawTerminal(){
+    // _getch already reads unbuffered without echo
+    active_ = _isatty(_fileno(stdin)) != 0;
+}
+
+RawTerminal::~RawTerminal() = default;
+
+int RawTerminal::read_key(){
+    int c = _getch();
+    if (c == 0 || c == 224){
+        int k = _getch();
+        if (k == 72) return KeyUp;
+        if (k == 80) return KeyDown;
+        return read_key();
+    }
+    if (c == '\r' || c == '\n') return KeyEnter;
+    if (c == 8) return KeyBackspace;
+    if (c == 27 || c == 3) return KeyEscape;
+    if (c == 26) return KeyEof;
+    return c;
+}
+#else
+RawTerminal::RawTerminal(){
+    if (!::isatty(STDIN_FILENO)) return;
+    saved_ = std::make_unique<struct ::termios>();
+    if (::tcgetattr(STDIN_FILENO, saved_.get()) != 0){ saved_.reset(); return; }
+    struct ::termios raw = *saved_;
+    raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (::tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0){ saved_.reset(); return; }
+    active_ = true;
+}
+
+RawTerminal::~RawTerminal(){
+    if (active_) ::tcsetattr(STDIN_FILENO, TCSANOW, saved_.get());
+}
+
+static int read_byte(int timeoutMs){
+    if (timeoutMs >= 0){
+        struct pollfd p{STDIN_FILENO, POLLIN, 0};
+        if (::poll(&p, 1, timeoutMs) <= 0) return -1;
+    }
+    unsigned char c;
+    return ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+
+int RawTerminal::read_key(){
+    int c = read_byte(-1);
+    if (c < 0 || c == 4) return KeyEof;
+    if (c == '\r' || c == '\n') return KeyEnter;
+    if (c == 127 || c == 8) return KeyBackspace;
+    if (c == 3) return KeyEscape;
+    if (c == 27){
+        // A lone ESC, or the start of an arrow-key sequence (ESC [ A / ESC O A)
+        int b = read_byte(30);
+        if (b != '[' && b != 'O') return KeyEscape;
+        int k = read_byte(30);
+        if (k == 'A') return KeyUp;
+        if (k == 'B') return KeyDown;
+        return read_key();
+    }
+    return c;
+}
+#endif
+
+SecondTicker::SecondTicker(){
+#if defined(__linux__)
+    fd_ = ::timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+    if (fd_ < 0) return;
+    struct timespec now{};
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    struct itimerspec spec{};
+    spec.it_value.tv_sec = now.tv_sec + 1;          // the next whole second
+    spec.it_interval.tv_sec = 1;
+    if (::timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0){
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+SecondTicker::~SecondTicker(){
+#if defined(__linux__)
+    if (fd_ >= 0) ::close(fd_);
+#endif
+}
+
+bool SecondTicker::wait(){
+#if defined(__linux__)
+    if (fd_ >= 0){
+        // Expirations missed while busy or suspended are folded into one tick
+        uint64_t expirations = 0;
+        return ::read(fd_, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations);
+    }
+#endif
+    using namespace std::chrono;
+    auto now = system_clock::now();
+    std::this_thread::sleep_until(time_point_cast<seconds>(now) + seconds(1));
+    return true;
+}
+
 } // namespace platform
@@ -1,7 +1,135 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
+
+#if !defined(_WIN32)
+struct termios;
+#endif
 
 namespace platform {
 std::filesystem::path resolve_config_path();
+// $HOME (%USERPROFILE% on Windows), or the working directory if unset
+std::filesystem::path home_dir();
+// Per-user cache directory: $XDG_CACHE_HOME/almuslim (~/.cache/almuslim), or
+// %LOCALAPPDATA%\almuslim\cache on Windows. Not created here.
+std::filesystem::path cache_dir();
+// Absolute path of the running executable as the OS reports it (not argv[0]);
+// empty if unavailable
+std::filesystem::path executable_path();
+
+// Read-only memory map of a whole file (falls back to reading it into memory
+// where mapping is unavailable). Pages are shared through the OS page cache.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+
+    bool open(const std::filesystem::path& p);
+    void close();
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool is_open() const { return data_ != nullptr; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;  // false: data_ is a heap copy
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Replace `p` with `data` so that readers see either the old or the new
+// contents, never a partial file: write a sibling temp file, flush it to disk,
+// then rename it over `p`. With durable = false nothing is flushed: readers
+// still never see a partial file, but a crash may lose the update (fine for
+// caches, which are rebuilt).
+bool write_file_atomic(const std::filesystem::path& p, std::string_view data, std::string* err = nullptr,
+                       bool durable = true);
+
+// Write `data` to standard output directly, bypassing the iostream buffers:
+// one write(2) unless the OS accepts less (a pipe full of a slow reader).
+// Do not mix with unflushed std::cout output.
+bool write_stdout(std::string_view data);
+
+// Notices when one file is written or replaced, e.g. a config pushed by a
+// deployment tool (usually written elsewhere and renamed into place). Uses
+// inotify on the file's directory on Linux; elsewhere, or if that fails, the
+// file's size and mtime are compared, at most once per poll interval.
+// Deleting the file is not reported as a change.
+class FileWatcher {
+public:
+    explicit FileWatcher(std::filesystem::path p);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Whether the file changed since the last call; never blocks
+    bool changed();
+    // For line-based prompts: block until the terminal has input (true) or
+    // the file changed (false). Does not block when stdin is not a terminal.
+    bool wait_for_input();
+
+private:
+    bool drain_events();
+    bool stamp_changed();
+
+    std::filesystem::path path_;
+    int fd_ = -1;                                   // inotify; -1 = polling
+    std::filesystem::file_time_type mtime_{};
+    uintmax_t size_ = 0;
+    std::chrono::steady_clock::time_point nextPoll_{};
+};
+
+// Wakes on every wall-clock second boundary, for displays that tick once a
+// second. On Linux a timerfd (absolute CLOCK_REALTIME, 1 s interval) keeps
+// the process asleep in one read() between ticks and aligned to the clock
+// without drift; elsewhere it sleeps until the next whole second.
+class SecondTicker {
+public:
+    SecondTicker();
+    ~SecondTicker();
+    SecondTicker(const SecondTicker&) = delete;
+    SecondTicker& operator=(const SecondTicker&) = delete;
+
+    // Block until the next second starts. False if a signal cut the wait short.
+    bool wait();
+
+private:
+    int fd_ = -1;                                   // timerfd; -1 = sleeping
+};
+
+// Keys reported by RawTerminal::read_key() besides plain bytes
+enum Key : int { KeyEof = -1, KeyEnter = 0x100, KeyBackspace, KeyUp, KeyDown, KeyEscape };
+
+// Unbuffered, no-echo keyboard input for the lifetime of the object; the
+// previous terminal mode is restored on destruction. active() is false when
+// stdin is not a terminal (piped input): callers should stay line-based then.
+class RawTerminal {
+public:
+    RawTerminal();
+    ~RawTerminal();
+    RawTerminal(const RawTerminal&) = delete;
+    RawTerminal& operator=(const RawTerminal&) = delete;
+
+    bool active() const { return active_; }
+    // Block for one key: a byte (UTF-8 sequences arrive byte by byte) or a Key.
+    // Ctrl-C is reported as KeyEscape.
+    int read_key();
+
+private:
+    bool active_ = false;
+#if !defined(_WIN32)
+    std::unique_ptr<struct ::termios> saved_;
+#endif
+};
 }
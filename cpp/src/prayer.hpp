@@ -0,0 +1,43 @@
+#pragma once
+#include <ctime>
+#include <optional>
+#include <string>
+
+namespace prayer {
+
+// Local clock times in fractional hours since midnight
+struct PrayerTimes { double fajr, sunrise, dhuhr, asr, maghrib, isha; };
+
+// Per-date solar parameters; identical for every location on that date,
+// so bulk callers compute them once and reuse across cities.
+struct SolarDay {
+    double eqTimeMin = 0.0; // equation of time (minutes)
+    double declDeg = 0.0;   // solar declination (degrees)
+};
+
+// Day of year (1..366) for a calendar date; only tm_year/tm_mon/tm_mday are read
+int day_of_year(const std::tm &tm);
+
+SolarDay solar_day(const std::tm &date);
+
+// Compute prayer times for a date and location. Without a timezone override
+// the current local UTC offset of this machine is used.
+std::optional<PrayerTimes> compute_prayer_times(const std::tm &date, double latitude, double longitude,
+                                                const std::string &method, const std::string &madhab,
+                                                const std::string &high_lat_rule,
+                                                std::optional<double> tzOverrideHours = std::nullopt);
+std::optional<PrayerTimes> compute_prayer_times(const SolarDay &sd, double latitude, double longitude,
+                                                const std::string &method, const std::string &madhab,
+                                                const std::string &high_lat_rule,
+                                                std::optional<double> tzOverrideHours = std::nullopt);
+
+// Get local UTC offset (hours) for current time (approx for today)
+double local_utc_offset_hours();
+
+// Parse a timezone setting ("+03:00", "UTC+3", "Asia/Riyadh") into hours east of UTC
+std::optional<double> parse_tz_hours(const std::string &s);
+
+// Format fractional hours as "HH:MM" or "h:MM AM"
+std::string fmt_time(double hours, bool use24h);
+
+} // namespace prayer
@@ -0,0 +1,143 @@
+#include "resources.hpp"
+#include "aliases.hpp"
+#include "citydb.hpp"
+#include "hijri.hpp"
+#include "platform.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+namespace resources {
+
+#if defined(ALMUSLIM_NO_EMBEDDED_DATA)
+// Built without the generated table (e.g. the Makefile when cmake is missing):
+// every dataset has to come from a data directory.
+const EmbeddedFile kEmbeddedFiles[] = {{nullptr, nullptr, 0}};
+const size_t kEmbeddedCount = 0;
+#endif
+
+static constexpr std::string_view kHijriFile = "hijri/umm_al_qura_month_starts.csv";
+
+const fs::path& exe_dir(){
+    static const fs::path dir = platform::executable_path().parent_path();
+    return dir;
+}
+
+const std::vector<fs::path>& data_dirs(){
+    static const std::vector<fs::path> dirs = [](){
+        std::vector<fs::path> out;
+        auto add = [&](fs::path p){
+            std::error_code ec;
+            if (p.empty() || !fs::is_directory(p, ec)) return;
+            if (std::find(out.begin(), out.end(), p) == out.end()) out.push_back(std::move(p));
+        };
+        if (const char* env = std::getenv("ALMUSLIM_DATA_DIR"); env && *env) add(env);
+        if (!exe_dir().empty()) add(exe_dir() / "data");
+#if defined(_WIN32)
+        if (const char* local = std::getenv("LOCALAPPDATA"); local && *local) add(fs::path(local) / "almuslim" / "data");
+#else
+        const char* home = std::getenv("XDG_DATA_HOME");
+        add((home && *home ? fs::path(home) : platform::home_dir() / ".local" / "share") / "almuslim" / "data");
+        const char* env = std::getenv("XDG_DATA_DIRS");
+        std::string_view list = (env && *env) ? env : "/usr/local/share:/usr/share";
+        while (!list.empty()){
+            size_t colon = list.find(':');
+            std::string_view dir = list.substr(0, colon);
+            if (!dir.empty()) add(fs::path(std::string(dir)) / "almuslim" / "data");
+            if (colon == std::string_view::npos) break;
+            list.remove_prefix(colon + 1);
+        }
+#endif
+        return out;
+    }();
+    return dirs;
+}
+
+fs::path find(std::string_view name){
+    fs::path rel = fs::path(std::string(name));
+    for (const fs::path& dir : data_dirs()){
+        std::error_code ec;
+        if (fs::is_regular_file(dir / rel, ec)) return dir / rel;
+    }
+    return {};
+}
+
+std::string_view embedded(std::string_view name){
+    for (size_t i = 0; i < kEmbeddedCount; ++i)
+        if (name == kEmbeddedFiles[i].name)
+            return std::string_view(reinterpret_cast<const char*>(kEmbeddedFiles[i].data), kEmbeddedFiles[i].size);
+    return {};
+}
+
+// First data directory with a city database (compiled index or CSV)
+static fs::path cities_dir(){
+    for (const fs::path& dir : data_dirs()){
+        std::error_code ec;
+        if (fs::is_regular_file(dir / "cities.idx", ec) || fs::is_regular_file(dir / "cities.csv", ec)) return dir;
+    }
+    return {};
+}
+
+static std::string g_citiesSource;
+
+const citydb::Index& cities(){
+    static const citydb::Index& db = []() -> const citydb::Index& {
+        if (!aliases::current()) load_aliases();
+        ALMUSLIM_TRACE_SCOPE("load_cities");
+        fs::path dir = cities_dir();
+        if (!dir.empty()){
+            g_citiesSource = dir.string();
+            return citydb::load(dir);
+        }
+        g_citiesSource = "built-in data";
+        // The embedded index was built with the embedded aliases; an alias
+        // override changes the normalized names, so rebuild from the CSV then
+        if (find("aliases.csv").empty()){
+            if (const citydb::Index* db = citydb::load_image(embedded("cities.idx"))) return *db;
+        }
+        return citydb::load_text(embedded("cities.csv"), "built-in cities.csv");
+    }();
+    return db;
+}
+
+std::string cities_source(){
+    cities();
+    return g_citiesSource;
+}
+
+bool load_aliases(){
+    ALMUSLIM_TRACE_SCOPE("load_aliases");
+    std::shared_ptr<const aliases::Dictionary> dict;
+    fs::path file = find("aliases.csv");
+    if (!file.empty()) dict = aliases::Dictionary::from_csv(file);
+    else if (std::string_view text = embedded("aliases.csv"); !text.empty()) dict = aliases::Dictionary::from_text(text);
+    if (!dict) return false;
+    aliases::publish(std::move(dict));
+    return true;
+}
+
+bool load_hijri(){
+    ALMUSLIM_TRACE_SCOPE("load_umm_al_qura");
+    std::shared_ptr<const hijri::Table> table;
+    fs::path file = find(kHijriFile);
+    if (!file.empty()) table = hijri::Table::from_csv(file);
+    else if (std::string_view text = embedded(kHijriFile); !text.empty()) table = hijri::Table::from_text(text);
+    if (!table) return false;
+    hijri::publish(std::move(table));
+    return true;
+}
+
+std::future<bool> load_hijri_async(){
+    // The embedded table is small enough to parse inline; only a file read is
+    // worth a thread.
+    if (find(kHijriFile).empty()){
+        std::promise<bool> done;
+        done.set_value(load_hijri());
+        return done.get_future();
+    }
+    return std::async(std::launch::async, [](){ return load_hijri(); });
+}
+
+} // namespace resources
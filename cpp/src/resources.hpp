@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace citydb { class Index; }
+
+namespace resources {
+
+// Directory of the running executable, asked of the OS (/proc/self/exe,
+// GetModuleFileNameW, _NSGetExecutablePath) instead of taken from argv[0],
+// which has no directory part when the program is found through PATH.
+// Resolved once; empty if the OS cannot tell.
+const std::filesystem::path& exe_dir();
+
+// Directories whose files override the copies compiled into the binary, in
+// lookup order: $ALMUSLIM_DATA_DIR, <exe dir>/data, then almuslim/data under
+// $XDG_DATA_HOME (~/.local/share) and each $XDG_DATA_DIRS entry
+// (/usr/local/share:/usr/share). Resolved once; only existing ones are kept.
+const std::vector<std::filesystem::path>& data_dirs();
+
+// data_dirs() entry holding `name` ("cities.csv", "hijri/..."), or empty
+std::filesystem::path find(std::string_view name);
+
+// Copy of data/<name> compiled into the binary; empty if it was not embedded
+std::string_view embedded(std::string_view name);
+
+// Datasets, each read on first use from an override file when there is one,
+// otherwise from the embedded copy (so a lone binary needs no files at all).
+
+// The city database; publishes the aliases first, since the index includes them
+const citydb::Index& cities();
+// Where cities() came from, for messages: a directory or "built-in data"
+std::string cities_source();
+// Parse and publish the spelling aliases (see aliases::load)
+bool load_aliases();
+// Parse and publish the Umm al-Qura table (see hijri::load_umm_al_qura). Reads
+// the override file again on every call, so a refresh picks up edits.
+bool load_hijri();
+std::future<bool> load_hijri_async();
+
+// One compiled-in file; the table is generated at build time by
+// cmake/EmbedData.cmake
+struct EmbeddedFile {
+    const char* name;
+    const unsigned char* data;
+    size_t size;                // excluding the NUL terminator
+};
+extern const EmbeddedFile kEmbeddedFiles[];
+extern const size_t kEmbeddedCount;
+
+} // namespace resources
@@ -0,0 +1,572 @@
+#include "settings.hpp"
+#include "platform.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace settings {
+
+static bool is_blank(char c){ return c == ' ' || c == '\t'; }
+static bool is_bare_key(char c){
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+// Cursor over one line of the buffer
+struct LineScanner {
+    const std::string& s;
+    size_t pos, end;
+    void skip_blanks(){ while (pos < end && is_blank(s[pos])) ++pos; }
+    bool at_end() const { return pos >= end; }
+    char peek() const { return pos < end ? s[pos] : '\0'; }
+    // Only blanks or a comment left
+    bool rest_is_empty(){ skip_blanks(); return at_end() || s[pos] == '#'; }
+};
+
+// Quoted string starting at sc.pos; on success sc.pos is past the closing quote
+static bool scan_string(LineScanner& sc, std::string* err){
+    char q = sc.s[sc.pos++];
+    while (sc.pos < sc.end){
+        char c = sc.s[sc.pos++];
+        if (c == q) return true;
+        if (c == '\\' && q == '"'){
+            if (sc.pos >= sc.end) break;
+            ++sc.pos;
+        }
+    }
+    *err = "unterminated string";
+    return false;
+}
+
+static bool parse_number(std::string_view tok, double& v, bool& integer){
+    std::string digits;
+    if (tok.find('_') != std::string_view::npos){
+        for (char c : tok) if (c != '_') digits.push_back(c);
+        tok = digits;
+    }
+    if (!tok.empty() && tok.front() == '+') tok.remove_prefix(1);
+    if (tok.empty()) return false;
+    integer = tok.find_first_of(".eE") == std::string_view::npos;
+    auto r = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    return r.ec == std::errc() && r.ptr == tok.data() + tok.size();
+}
+
+Document Document::parse(std::string text){
+    Document d;
+    d.text_ = std::move(text);
+    const std::string& s = d.text_;
+    size_t pos = 0, line = 0;
+    if (s.size() >= 3 && (unsigned char)s[0] == 0xEF && (unsigned char)s[1] == 0xBB && (unsigned char)s[2] == 0xBF) pos = 3;
+    while (pos < s.size()){
+        ++line;
+        size_t nl = s.find('\n', pos);
+        size_t end = nl == std::string::npos ? s.size() : nl;
+        size_t next = nl == std::string::npos ? s.size() : nl + 1;
+        if (end > pos && s[end - 1] == '\r') --end;
+        LineScanner sc{s, pos, end};
+        pos = next;
+        auto fail = [&](std::string msg){ d.errors_.push_back(ParseError{line, std::move(msg)}); };
+
+        if (sc.rest_is_empty()) continue;
+        if (sc.peek() == '['){
+            Table t;
+            t.line = line;
+            ++sc.pos;
+            if (sc.peek() == '['){ t.array = true; ++sc.pos; }
+            size_t close = s.find(']', sc.pos);
+            if (close == std::string::npos || close >= end){ fail("unterminated table header"); continue; }
+            size_t a = sc.pos, b = close;
+            while (a < b && is_blank(s[a])) ++a;
+            while (b > a && is_blank(s[b - 1])) --b;
+            sc.pos = close + 1;
+            if (t.array){
+                if (sc.peek() != ']'){ fail("expected ]] after array table name"); continue; }
+                ++sc.pos;
+            }
+            if (a == b){ fail("empty table name"); continue; }
+            if (!sc.rest_is_empty()){ fail("unexpected text after table header"); continue; }
+            t.name = Span{(uint32_t)a, (uint32_t)(b - a)};
+            d.tables_.push_back(t);
+            continue;
+        }
+
+        Item it;
+        it.table = (uint32_t)(d.tables_.size() - 1);
+        it.line = line;
+        // Key
+        if (sc.peek() == '"' || sc.peek() == '\''){
+            size_t a = sc.pos;
+            std::string err;
+            if (!scan_string(sc, &err)){ fail(err); continue; }
+            it.key = Span{(uint32_t)(a + 1), (uint32_t)(sc.pos - a - 2)};
+        } else {
+            size_t a = sc.pos;
+            while (sc.pos < end && is_bare_key(s[sc.pos])) ++sc.pos;
+            if (sc.pos == a){ fail("expected a key"); continue; }
+            it.key = Span{(uint32_t)a, (uint32_t)(sc.pos - a)};
+        }
+        sc.skip_blanks();
+        if (sc.peek() != '='){ fail("expected = after key"); continue; }
+        ++sc.pos;
+        sc.skip_blanks();
+        // Value
+        size_t v0 = sc.pos;
+        if (sc.at_end() || sc.peek() == '#'){ fail("missing value"); continue; }
+        if (sc.peek() == '"' || sc.peek() == '\''){
+            std::string err;
+            if (!scan_string(sc, &err)){ fail(err); continue; }
+            it.kind = ValueKind::String;
+        } else {
+            while (sc.pos < end && !is_blank(s[sc.pos]) && s[sc.pos] != '#') ++sc.pos;
+            std::string_view tok(s.data() + v0, sc.pos - v0);
+            double v; bool integer = false;
+            if (tok == "true" || tok == "false") it.kind = ValueKind::Bool;
+            else if (parse_number(tok, v, integer)) it.kind = integer ? ValueKind::Integer : ValueKind::Float;
+            else { fail("invalid value '" + std::string(tok) + "'"); continue; }
+        }
+        it.raw = Span{(uint32_t)v0, (uint32_t)(sc.pos - v0)};
+        if (!sc.rest_is_empty()){ fail("unexpected text after value"); continue; }
+        // Within one table a key may appear only once; the first one wins
+        bool dup = false;
+        for (auto r = d.items_.rbegin(); r != d.items_.rend() && r->table == it.table; ++r){
+            if (d.view(r->key) == d.view(it.key)){ dup = true; break; }
+        }
+        if (dup){ fail("duplicate key '" + std::string(d.view(it.key)) + "'"); continue; }
+        d.items_.push_back(it);
+    }
+    return d;
+}
+
+// Plain stdio rather than an ifstream: it is the only read on the --once
+// path, and stdio skips the stream and locale setup
+static std::optional<std::string> read_text(const fs::path& p){
+#if defined(_WIN32)
+    std::FILE* f = _wfopen(p.c_str(), L"rb");
+#else
+    std::FILE* f = std::fopen(p.c_str(), "rb");
+#endif
+    if (!f) return std::nullopt;
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    if (!ok) return std::nullopt;
+    return text;
+}
+
+std::optional<Document> Document::load(const fs::path& p){
+    std::optional<std::string> text = read_text(p);
+    if (!text) return std::nullopt;
+    return parse(std::move(*text));
+}
+
+static void append_utf8(std::string& out, uint32_t cp){
+    if (cp < 0x80) out.push_back((char)cp);
+    else if (cp < 0x800){ out.push_back((char)(0xC0 | (cp >> 6))); out.push_back((char)(0x80 | (cp & 0x3F))); }
+    else if (cp < 0x10000){
+        out.push_back((char)(0xE0 | (cp >> 12))); out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | (cp >> 18))); out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F))); out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+std::string Document::value(const Item& it) const {
+    std::string_view raw = view(it.raw);
+    if (it.kind != ValueKind::String || raw.size() < 2) return std::string(raw);
+    std::string_view body = raw.substr(1, raw.size() - 2);
+    if (raw.front() == '\'' || body.find('\\') == std::string_view::npos) return std::string(body);
+    std::string out;
+    out.reserve(body.size());
+    for (size_t i=0;i<body.size();++i){
+        char c = body[i];
+        if (c != '\\' || i + 1 >= body.size()){ out.push_back(c); continue; }
+        char e = body[++i];
+        switch (e){
+            case 'n': out.push_back('\n'); break;
+            case 't': out.push_back('\t'); break;
+            case 'r': out.push_back('\r'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'u': case 'U': {
+                size_t n = e == 'u' ? 4 : 8;
+                uint32_t cp = 0;
+                if (i + n < body.size() && std::from_chars(body.data() + i + 1, body.data() + i + 1 + n, cp, 16).ptr == body.data() + i + 1 + n){
+                    append_utf8(out, cp);
+                    i += n;
+                } else {
+                    out.push_back('\\'); out.push_back(e);
+                }
+                break;
+            }
+            default: out.push_back(e); break;   // \" and \\ (and unknown escapes kept literally)
+        }
+    }
+    return out;
+}
+
+const Item* Document::find(std::string_view table, std::string_view key) const {
+    for (const auto& it : items_){
+        if (table_name(it) == table && this->key(it) == key) return &it;
+    }
+    return nullptr;
+}
+
+std::string quote(std::string_view s){
+    std::string out;
+    out.reserve(s.size() + 2);
+    out.push_back('"');
+    for (char c : s){
+        switch (c){
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if ((unsigned char)c < 0x20){
+                    char esc[8]; std::snprintf(esc, sizeof(esc), "\\u%04x", (unsigned)c);
+                    out += esc;
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+// Six decimals (about 10 cm for coordinates) without trailing zeros
+std::string number_token(double v){
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.6f", v);
+    std::string out(buf);
+    size_t dot = out.find('.');
+    if (dot != std::string::npos){
+        size_t last = out.find_last_not_of('0');
+        out.erase(std::max(last + 1, dot + 2));
+    }
+    return out;
+}
+
+std::string_view Document::eol() const {
+    return text_.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+}
+
+// Offset just past the newline ending the line that contains `off`
+size_t Document::line_end(size_t off) const {
+    size_t nl = text_.find('\n', off);
+    return nl == std::string::npos ? text_.size() : nl + 1;
+}
+
+// Replace text_[off, off+len) and move everything after it. Replaced ranges
+// are single value tokens, so only inserted text can add lines.
+void Document::splice(size_t off, size_t len, std::string_view with){
+    text_.replace(off, len, with.data(), with.size());
+    size_t added = (size_t)std::count(with.begin(), with.end(), '\n');
+    uint32_t from = (uint32_t)(off + len);
+    int64_t delta = (int64_t)with.size() - (int64_t)len;
+    auto moves = [&](const Span& sp){ return sp.off >= from && !(sp.off == 0 && sp.len == 0); };
+    for (auto& t : tables_){
+        if (!moves(t.name)) continue;
+        t.name.off = (uint32_t)(t.name.off + delta);
+        t.line += added;
+    }
+    for (auto& it : items_){
+        if (!moves(it.key)) continue;
+        it.key.off = (uint32_t)(it.key.off + delta);
+        it.raw.off = (uint32_t)(it.raw.off + delta);
+        it.line += added;
+    }
+}
+
+const Item& Document::set(std::string_view table, std::string_view key, std::string_view raw, ValueKind kind){
+    // Rewrite the entry from_document() would read: the last one in [table] or at the top level
+    Item* hit = nullptr;
+    for (auto& it : items_){
+        if (tables_[it.table].array || this->key(it) != key) continue;
+        std::string_view t = table_name(it);
+        if (t == table || t.empty()) hit = &it;
+    }
+    if (hit){
+        splice(hit->raw.off, hit->raw.len, raw);
+        hit->raw.len = (uint32_t)raw.size();
+        hit->kind = kind;
+        return *hit;
+    }
+
+    std::string_view nl = eol();
+    // Top-level keys, and any key of a flat file written by an older version
+    uint32_t ti = 0;
+    bool found = table.empty() || (tables_.size() == 1 && !items_.empty());
+    for (size_t i = tables_.size(); !found && i-- > 1;){
+        if (!tables_[i].array && view(tables_[i].name) == table){ ti = (uint32_t)i; found = true; }
+    }
+    size_t at, line;
+    if (found){
+        // After the section's last entry, or right under its header
+        const Item* last = nullptr;
+        for (const auto& it : items_) if (it.table == ti) last = &it;
+        if (last || ti > 0){
+            at = line_end(last ? last->raw.off : tables_[ti].name.off);
+            line = (last ? last->line : tables_[ti].line) + 1;
+        } else {
+            bool bom = text_.size() >= 3 && text_.compare(0, 3, "\xEF\xBB\xBF") == 0;
+            at = bom ? 3 : 0;
+            line = 1;
+        }
+        if (at == text_.size() && at > 0 && text_.back() != '\n'){ splice(at, 0, nl); at = text_.size(); }
+    } else {
+        std::string head;
+        if (!text_.empty() && text_.back() != '\n') head += nl;
+        if (!text_.empty()) head += nl;
+        size_t nameOff = text_.size() + head.size() + 1;
+        head += "["; head += table; head += "]"; head += nl;
+        splice(text_.size(), 0, head);
+        Table t;
+        t.name = Span{(uint32_t)nameOff, (uint32_t)table.size()};
+        t.line = (size_t)std::count(text_.begin(), text_.end(), '\n');
+        tables_.push_back(t);
+        ti = (uint32_t)(tables_.size() - 1);
+        at = text_.size();
+        line = t.line + 1;
+    }
+
+    bool bare = !key.empty() && std::all_of(key.begin(), key.end(), is_bare_key);
+    std::string k = bare ? std::string(key) : quote(key);
+    std::string text = k + " = ";
+    text += raw;
+    text += nl;
+    splice(at, 0, text);
+    Item it;
+    it.table = ti;
+    it.key = bare ? Span{(uint32_t)at, (uint32_t)k.size()} : Span{(uint32_t)at + 1, (uint32_t)k.size() - 2};
+    it.raw = Span{(uint32_t)(at + k.size() + 3), (uint32_t)raw.size()};
+    it.kind = kind;
+    it.line = line;
+    auto pos = std::find_if(items_.begin(), items_.end(), [&](const Item& x){ return x.table > ti; });
+    return *items_.insert(pos, it);
+}
+
+// Conversion of known keys to Config fields
+namespace {
+
+struct Reader {
+    const Document& doc;
+    const Item& it;
+    std::vector<ParseError>* errors;
+
+    void bad(const char* what) const {
+        if (errors) errors->push_back(ParseError{it.line, std::string(doc.key(it)) + ": expected " + what});
+    }
+    std::string str() const { return doc.value(it); }
+    bool number(double& out) const {
+        double v; bool integer;
+        if ((it.kind == ValueKind::Integer || it.kind == ValueKind::Float || it.kind == ValueKind::String)
+            && parse_number(doc.value(it), v, integer)){ out = v; return true; }
+        bad("a number");
+        return false;
+    }
+    // Booleans may also be quoted ("true") or spelled 1/yes/0/no, as older versions wrote them
+    bool boolean(bool& out) const {
+        std::string v = doc.value(it);
+        for (char& c : v) c = (char)std::tolower((unsigned char)c);
+        if (v == "true" || v == "1" || v == "yes"){ out = true; return true; }
+        if (v == "false" || v == "0" || v == "no"){ out = false; return true; }
+        bad("true or false");
+        return false;
+    }
+};
+
+using Setter = void (*)(Config&, const Reader&);
+
+struct Field {
+    const char* table;
+    const char* key;
+    Setter set;
+};
+
+const Field kFields[] = {
+    {"location", "city", [](Config& c, const Reader& r){ c.city = r.str(); }},
+    {"location", "latitude", [](Config& c, const Reader& r){
+        double v; if (r.number(v)){ if (v >= -90 && v <= 90) c.latitude = v; else r.bad("a latitude in [-90, 90]"); } }},
+    {"location", "longitude", [](Config& c, const Reader& r){
+        double v; if (r.number(v)){ if (v >= -180 && v <= 180) c.longitude = v; else r.bad("a longitude in [-180, 180]"); } }},
+    {"location", "timezone", [](Config& c, const Reader& r){ c.timezone = r.str(); }},
+    {"location", "elevation_m", [](Config& c, const Reader& r){ r.number(c.elevationM); }},
+    {"calculation", "method", [](Config& c, const Reader& r){ c.method = r.str(); }},
+    {"calculation", "madhab", [](Config& c, const Reader& r){ c.madhab = r.str(); }},
+    {"calculation", "high_latitude_rule", [](Config& c, const Reader& r){ c.highLatRule = r.str(); }},
+    {"calculation", "fajr_angle", [](Config& c, const Reader& r){ double v; if (r.number(v)) c.fajrAngle = v; }},
+    {"calculation", "isha_angle", [](Config& c, const Reader& r){ double v; if (r.number(v)) c.ishaAngle = v; }},
+    {"ui", "language", [](Config& c, const Reader& r){
+        std::string v = r.str(); for (char& ch : v) ch = (char)std::tolower((unsigned char)ch);
+        c.language = (v == "ar" || v == "arabic") ? Language::Ar : Language::En; }},
+    {"ui", "24h", [](Config& c, const Reader& r){ r.boolean(c.use24h); }},
+    {"ui", "colors", [](Config& c, const Reader& r){
+        std::string v = r.str(); for (char& ch : v) ch = (char)std::tolower((unsigned char)ch);
+        if (v == "none" || v == "off") c.colors = ColorMode::None;
+        else if (v == "light") c.colors = ColorMode::Light;
+        else if (v == "dark") c.colors = ColorMode::Dark;
+        else c.colors = ColorMode::Auto; }},
+    {"ui", "fg", [](Config& c, const Reader& r){ c.fg = r.str(); }},
+    {"ui", "bg", [](Config& c, const Reader& r){ c.bg = r.str(); }},
+    {"ui", "ask_on_start", [](Config& c, const Reader& r){ r.boolean(c.askOnStart); }},
+    {"updates", "auto_check", [](Config& c, const Reader& r){ r.boolean(c.autoCheck); }},
+    {"updates", "channel", [](Config& c, const Reader& r){ c.channel = r.str(); }},
+    {"paths", "config_dir", [](Config& c, const Reader& r){ c.configDir = r.str(); }},
+};
+
+// [[profiles]] entries; coordinates are required
+struct ProfileDraft {
+    Profile p;
+    bool hasLat = false, hasLon = false;
+};
+
+using ProfileSetter = void (*)(ProfileDraft&, const Reader&);
+
+struct ProfileField {
+    const char* key;
+    ProfileSetter set;
+};
+
+const ProfileField kProfileFields[] = {
+    {"name", [](ProfileDraft& d, const Reader& r){ d.p.name = r.str(); }},
+    {"latitude", [](ProfileDraft& d, const Reader& r){
+        double v; if (r.number(v)){ if (v >= -90 && v <= 90){ d.p.latitude = v; d.hasLat = true; } else r.bad("a latitude in [-90, 90]"); } }},
+    {"longitude", [](ProfileDraft& d, const Reader& r){
+        double v; if (r.number(v)){ if (v >= -180 && v <= 180){ d.p.longitude = v; d.hasLon = true; } else r.bad("a longitude in [-180, 180]"); } }},
+    {"timezone", [](ProfileDraft& d, const Reader& r){ d.p.timezone = r.str(); }},
+    {"method", [](ProfileDraft& d, const Reader& r){ d.p.method = r.str(); }},
+    {"madhab", [](ProfileDraft& d, const Reader& r){ d.p.madhab = r.str(); }},
+    {"high_latitude_rule", [](ProfileDraft& d, const Reader& r){ d.p.highLatRule = r.str(); }},
+    {"fajr_offset", [](ProfileDraft& d, const Reader& r){ r.number(d.p.offsetMin[0]); }},
+    {"sunrise_offset", [](ProfileDraft& d, const Reader& r){ r.number(d.p.offsetMin[1]); }},
+    {"dhuhr_offset", [](ProfileDraft& d, const Reader& r){ r.number(d.p.offsetMin[2]); }},
+    {"asr_offset", [](ProfileDraft& d, const Reader& r){ r.number(d.p.offsetMin[3]); }},
+    {"maghrib_offset", [](ProfileDraft& d, const Reader& r){ r.number(d.p.offsetMin[4]); }},
+    {"isha_offset", [](ProfileDraft& d, const Reader& r){ r.number(d.p.offsetMin[5]); }},
+};
+
+bool same_profile(const Profile& a, const Profile& b){
+    return a.name == b.name && a.latitude == b.latitude && a.longitude == b.longitude && a.timezone == b.timezone
+        && a.method == b.method && a.madhab == b.madhab && a.highLatRule == b.highLatRule
+        && std::equal(std::begin(a.offsetMin), std::end(a.offsetMin), std::begin(b.offsetMin));
+}
+
+} // namespace
+
+Config from_document(const Document& doc, std::vector<ParseError>* errors){
+    Config c;
+    // Each [[profiles]] header starts a new entry
+    std::vector<int> draftOf(doc.tables().size(), -1);
+    std::vector<ProfileDraft> drafts;
+    for (size_t t = 1; t < doc.tables().size(); ++t){
+        const Table& tb = doc.tables()[t];
+        if (!tb.array || doc.view(tb.name) != "profiles") continue;
+        draftOf[t] = (int)drafts.size();
+        drafts.emplace_back();
+        drafts.back().p.line = tb.line;
+    }
+    for (const auto& it : doc.items()){
+        std::string_view table = doc.table_name(it);
+        if (doc.tables()[it.table].array){
+            if (draftOf[it.table] < 0) continue;
+            for (const auto& f : kProfileFields){
+                if (doc.key(it) != f.key) continue;
+                f.set(drafts[(size_t)draftOf[it.table]], Reader{doc, it, errors});
+                break;
+            }
+            continue;
+        }
+        std::string_view key = doc.key(it);
+        for (const auto& f : kFields){
+            // Top-level keys are the flat layout older versions wrote
+            if (key != f.key || (!table.empty() && table != f.table)) continue;
+            f.set(c, Reader{doc, it, errors});
+            break;
+        }
+    }
+    for (auto& d : drafts){
+        if (!d.hasLat || !d.hasLon){
+            if (errors) errors->push_back(ParseError{d.p.line, "profile needs latitude and longitude"});
+            continue;
+        }
+        if (d.p.name.empty()) d.p.name = "Profile " + std::to_string(c.profiles.size() + 1);
+        c.profiles.push_back(std::move(d.p));
+    }
+    return c;
+}
+
+Config load(const fs::path& p, std::vector<ParseError>* errors){
+    std::optional<Document> doc = Document::load(p);
+    if (!doc) return Config{};
+    if (errors) *errors = doc->errors();
+    return from_document(*doc, errors);
+}
+
+unsigned diff(const Config& a, const Config& b){
+    unsigned d = ChangeNone;
+    if (a.city != b.city || a.latitude != b.latitude || a.longitude != b.longitude
+        || a.timezone != b.timezone || a.elevationM != b.elevationM) d |= ChangeLocation;
+    if (a.method != b.method || a.madhab != b.madhab || a.highLatRule != b.highLatRule
+        || a.fajrAngle != b.fajrAngle || a.ishaAngle != b.ishaAngle) d |= ChangeCalculation;
+    if (a.language != b.language || a.use24h != b.use24h) d |= ChangeLabels;
+    if (a.colors != b.colors || a.fg != b.fg || a.bg != b.bg) d |= ChangeTheme;
+    if (a.profiles.size() != b.profiles.size()
+        || !std::equal(a.profiles.begin(), a.profiles.end(), b.profiles.begin(), same_profile)) d |= ChangeProfiles;
+    if (a.askOnStart != b.askOnStart || a.autoCheck != b.autoCheck || a.channel != b.channel
+        || a.configDir != b.configDir) d |= ChangeOther;
+    return d;
+}
+
+void Store::load(std::vector<ParseError>* errors){
+    std::optional<Document> d = path_.empty() ? std::nullopt : Document::load(path_);
+    doc_ = d ? std::move(*d) : Document{};
+    if (errors) *errors = doc_.errors();
+    config_ = from_document(doc_, errors);
+    dirty_ = false;
+}
+
+bool Store::reload(std::vector<ParseError>* errors){
+    std::optional<std::string> text = path_.empty() ? std::nullopt : read_text(path_);
+    // A file that vanished keeps the settings in memory
+    if (!text || *text == doc_.text()) return false;
+    doc_ = Document::parse(std::move(*text));
+    if (errors) *errors = doc_.errors();
+    config_ = from_document(doc_, errors);
+    dirty_ = false;
+    return true;
+}
+
+void Store::set(std::string_view key, std::string raw, ValueKind kind){
+    const Field* field = nullptr;
+    for (const auto& f : kFields) if (key == f.key){ field = &f; break; }
+    // Unknown keys go to the top level and have no typed counterpart
+    const Item& it = doc_.set(field ? field->table : "", key, raw, kind);
+    if (field) field->set(config_, Reader{doc_, it, nullptr});
+    dirty_ = true;
+}
+
+void Store::set_string(std::string_view key, std::string_view value){ set(key, quote(value), ValueKind::String); }
+void Store::set_number(std::string_view key, double value){ set(key, number_token(value), ValueKind::Float); }
+void Store::set_bool(std::string_view key, bool value){ set(key, value ? "true" : "false", ValueKind::Bool); }
+
+bool Store::save(std::string* err){
+    if (!dirty_) return true;
+    std::error_code ec;
+    if (path_.has_parent_path()) fs::create_directories(path_.parent_path(), ec);
+    if (!platform::write_file_atomic(path_, doc_.text(), err)) return false;
+    dirty_ = false;
+    return true;
+}
+
+} // namespace settings
@@ -0,0 +1,191 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace settings {
+
+// A problem found while reading the config (1-based line number)
+struct ParseError { size_t line; std::string message; };
+
+// Byte range in Document::text()
+struct Span { uint32_t off = 0; uint32_t len = 0; };
+
+enum class ValueKind { String, Integer, Float, Bool };
+
+// A [table] or [[array]] header. Table 0 is the implicit root (keys before the
+// first header); the others are numbered in file order, so each [[profiles]]
+// occurrence is its own table.
+struct Table {
+    Span name;
+    bool array = false;
+    size_t line = 0;
+};
+
+// One key = value line
+struct Item {
+    uint32_t table = 0;     // index into Document::tables()
+    Span key;               // unquoted key text
+    Span raw;               // value token as written (quotes included)
+    ValueKind kind = ValueKind::String;
+    size_t line = 0;
+};
+
+// The TOML subset used by config.toml: [table] and [[array]] headers, bare or
+// quoted keys, basic ("...", with escapes) and literal ('...') strings,
+// integers, floats and booleans, and # comments outside strings. The file is
+// read into one buffer and parsed in a single pass; items refer to it by byte
+// range instead of copying keys and values out.
+class Document {
+public:
+    static Document parse(std::string text);
+    // std::nullopt if the file cannot be read
+    static std::optional<Document> load(const std::filesystem::path& p);
+
+    const std::string& text() const { return text_; }
+    std::string_view view(Span s) const { return std::string_view(text_).substr(s.off, s.len); }
+    const std::vector<Table>& tables() const { return tables_; }
+    const std::vector<Item>& items() const { return items_; }
+    // Lines that could not be parsed (they are skipped)
+    const std::vector<ParseError>& errors() const { return errors_; }
+
+    std::string_view table_name(const Item& it) const { return view(tables_[it.table].name); }
+    std::string_view key(const Item& it) const { return view(it.key); }
+    // Decoded value: escapes resolved and quotes removed for strings, the
+    // token itself otherwise
+    std::string value(const Item& it) const;
+    // First item `key` directly under a table named `table` ("" = root)
+    const Item* find(std::string_view table, std::string_view key) const;
+
+    // Set `key` in [table] to the value token `raw` (quotes included for
+    // strings), editing the text in place. An existing entry is rewritten where
+    // it is, in its section or at the top of a flat legacy file; otherwise the
+    // key is added at the end of the section, which is appended if missing.
+    // Comments, blank lines and the order of everything else are untouched.
+    const Item& set(std::string_view table, std::string_view key, std::string_view raw, ValueKind kind);
+
+private:
+    void splice(size_t off, size_t len, std::string_view with);
+    size_t line_end(size_t off) const;
+    std::string_view eol() const;
+
+    std::string text_;
+    std::vector<Table> tables_ = {Table{}};
+    std::vector<Item> items_;
+    std::vector<ParseError> errors_;
+};
+
+enum class Language { En, Ar };
+enum class ColorMode { Auto, Light, Dark, None };
+
+// One [[profiles]] entry: a named location shown next to the main one by
+// --all-profiles. Settings left out fall back to the main config.
+struct Profile {
+    std::string name;
+    double latitude = 0.0;
+    double longitude = 0.0;
+    std::string timezone;
+    std::string method;
+    std::string madhab;
+    std::string highLatRule;
+    // Minutes added to fajr, sunrise, dhuhr, asr, maghrib, isha
+    double offsetMin[6] = {0, 0, 0, 0, 0, 0};
+    size_t line = 0;                    // of its [[profiles]] header
+};
+
+// Typed view of config.toml, converted once after parsing. Keys are read from
+// their section ([location], [calculation], [ui], ...) or, for configs
+// written by older versions, from the top level; each [[profiles]] table adds
+// a Profile. Calculation settings stay
+// strings because prayer::compute_prayer_times takes method names.
+struct Config {
+    // [location]
+    std::string city;                   // display name; empty = unset
+    std::optional<double> latitude;
+    std::optional<double> longitude;
+    std::string timezone;               // "+03:00", "UTC+3" or an IANA name; empty = system
+    double elevationM = 0.0;
+    // [calculation]
+    std::string method = "umm_al_qura";
+    std::string madhab = "shafi";
+    std::string highLatRule = "middle_of_the_night";
+    std::optional<double> fajrAngle;
+    std::optional<double> ishaAngle;
+    // [ui]
+    Language language = Language::En;
+    bool use24h = true;
+    ColorMode colors = ColorMode::Auto;
+    std::string fg;                     // color name or 0-255; empty = terminal default
+    std::string bg;
+    bool askOnStart = false;
+    // [updates]
+    bool autoCheck = true;
+    std::string channel = "stable";
+    // [paths]
+    std::string configDir;
+    // [[profiles]], in file order; entries without coordinates are dropped
+    std::vector<Profile> profiles;
+
+    bool has_location() const { return latitude && longitude; }
+    bool arabic() const { return language == Language::Ar; }
+};
+
+// What differs between two configs, so that a reload redoes only that
+enum Change : unsigned {
+    ChangeNone = 0,
+    ChangeLocation = 1 << 0,     // city, coordinates, timezone, elevation
+    ChangeCalculation = 1 << 1,  // method, madhab, high-latitude rule, angles
+    ChangeLabels = 1 << 2,       // language, clock format
+    ChangeTheme = 1 << 3,        // colors
+    ChangeProfiles = 1 << 4,     // [[profiles]]
+    ChangeOther = 1 << 5,        // updates, paths, ask_on_start
+};
+unsigned diff(const Config& a, const Config& b);
+
+// TOML tokens for Document::set
+std::string quote(std::string_view s);
+std::string number_token(double v);
+
+// Values of unknown keys are ignored; known keys with the wrong type are
+// reported and keep their defaults.
+Config from_document(const Document& doc, std::vector<ParseError>* errors = nullptr);
+// Parse errors and type errors together; defaults if the file is missing
+Config load(const std::filesystem::path& p, std::vector<ParseError>* errors = nullptr);
+
+// config.toml held in memory: the parsed document, so that edits keep the
+// file's layout, and the Config derived from it. Updates change both without
+// re-reading anything; save() writes the file once.
+class Store {
+public:
+    Store() = default;
+    explicit Store(std::filesystem::path p) : path_(std::move(p)) {}
+
+    // (Re)read the file. A missing file gives an empty document and defaults.
+    void load(std::vector<ParseError>* errors = nullptr);
+    // Re-parse only if the file differs from the document in memory (so our
+    // own saves are skipped); false if nothing was reloaded
+    bool reload(std::vector<ParseError>* errors = nullptr);
+    const std::filesystem::path& path() const { return path_; }
+    const Config& config() const { return config_; }
+    const Document& document() const { return doc_; }
+
+    // Update one key, named as in the file ("latitude", "24h", ...)
+    void set_string(std::string_view key, std::string_view value);
+    void set_number(std::string_view key, double value);
+    void set_bool(std::string_view key, bool value);
+    // Write the document if it changed since load() or the last save()
+    bool save(std::string* err = nullptr);
+
+private:
+    void set(std::string_view key, std::string raw, ValueKind kind);
+
+    std::filesystem::path path_;
+    Document doc_;
+    Config config_;
+    bool dirty_ = false;
+};
+
+} // namespace settings
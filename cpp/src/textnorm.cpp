@@ -0,0 +1,124 @@
+#include "textnorm.hpp"
+#include <array>
+#include <cstdint>
+
+namespace textnorm {
+
+namespace {
+
+// Base letters for U+00C0..U+024F (Latin-1 Supplement, Latin Extended-A/B);
+// "" drops the character (symbols such as U+00D7, unmapped letters)
+constexpr uint32_t kLatinFirst = 0xC0;
+const char* const kLatin[] = {
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",  // U+00C0
+    "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "ss",  // U+00D0
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",  // U+00E0
+    "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "y",  // U+00F0
+    "a", "a", "a", "a", "a", "a", "c", "c", "c", "c", "c", "c", "c", "c", "d", "d",  // U+0100
+    "d", "d", "e", "e", "e", "e", "e", "e", "e", "e", "e", "e", "g", "g", "g", "g",  // U+0110
+    "g", "g", "g", "g", "h", "h", "h", "h", "i", "i", "i", "i", "i", "i", "i", "i",  // U+0120
+    "i", "i", "ij", "ij", "j", "j", "k", "k", "k", "l", "l", "l", "l", "l", "l", "l",  // U+0130
+    "l", "l", "l", "n", "n", "n", "n", "n", "n", "n", "n", "n", "o", "o", "o", "o",  // U+0140
+    "o", "o", "oe", "oe", "r", "r", "r", "r", "r", "r", "s", "s", "s", "s", "s", "s",  // U+0150
+    "s", "s", "t", "t", "t", "t", "t", "t", "u", "u", "u", "u", "u", "u", "u", "u",  // U+0160
+    "u", "u", "u", "u", "w", "w", "y", "y", "y", "z", "z", "z", "z", "z", "z", "s",  // U+0170
+    "b", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "",  // U+0180
+    "", "", "f", "", "", "", "", "i", "", "", "", "", "", "", "", "",  // U+0190
+    "o", "o", "", "", "", "", "", "", "", "", "", "", "", "", "", "u",  // U+01A0
+    "u", "", "", "", "", "z", "z", "", "", "", "", "", "", "", "", "",  // U+01B0
+    "", "", "", "", "dz", "dz", "dz", "lj", "lj", "lj", "nj", "nj", "nj", "a", "a", "i",  // U+01C0
+    "i", "o", "o", "u", "u", "u", "u", "u", "u", "u", "u", "u", "u", "", "a", "a",  // U+01D0
+    "a", "a", "", "", "g", "g", "g", "g", "k", "k", "o", "o", "o", "o", "", "",  // U+01E0
+    "j", "dz", "dz", "dz", "g", "g", "", "", "n", "n", "a", "a", "", "", "", "",  // U+01F0
+    "a", "a", "a", "a", "e", "e", "e", "e", "i", "i", "i", "i", "o", "o", "o", "o",  // U+0200
+    "r", "r", "r", "r", "u", "u", "u", "u", "s", "s", "t", "t", "", "", "h", "h",  // U+0210
+    "", "", "", "", "", "", "a", "a", "e", "e", "o", "o", "o", "o", "o", "o",  // U+0220
+    "o", "o", "y", "y", "", "", "", "", "", "", "", "", "", "", "", "",  // U+0230
+    "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "",  // U+0240
+};
+constexpr uint32_t kLatinLast = kLatinFirst + sizeof(kLatin) / sizeof(kLatin[0]) - 1;
+
+// U+0600..U+06FF: 0 drops, values below 0x80 are ASCII, anything else is the
+// code point to emit
+constexpr std::array<uint16_t, 256> make_arabic(){
+    std::array<uint16_t, 256> t{};
+    for (uint32_t cp = 0x0621; cp <= 0x063A; ++cp) t[cp - 0x600] = (uint16_t)cp;   // hamza .. ghain
+    for (uint32_t cp = 0x0641; cp <= 0x064A; ++cp) t[cp - 0x600] = (uint16_t)cp;   // feh .. yeh
+    for (uint32_t cp = 0x0671; cp <= 0x06D5; ++cp) t[cp - 0x600] = (uint16_t)cp;   // extended letters
+    for (uint32_t cp = 0x06EE; cp <= 0x06FF; ++cp) t[cp - 0x600] = (uint16_t)cp;
+    for (uint32_t d = 0; d < 10; ++d){
+        t[0x0660 - 0x600 + d] = (uint16_t)('0' + d);   // Arabic-Indic digits
+        t[0x06F0 - 0x600 + d] = (uint16_t)('0' + d);   // extended (Persian/Urdu) digits
+    }
+    t[0x060C - 0x600] = ',';
+    // Alef with madda / hamza above / hamza below, alef wasla and friends
+    t[0x0622 - 0x600] = t[0x0623 - 0x600] = t[0x0625 - 0x600] = 0x0627;
+    t[0x0671 - 0x600] = t[0x0672 - 0x600] = t[0x0673 - 0x600] = 0x0627;
+    t[0x0624 - 0x600] = 0x0648;                          // waw with hamza
+    t[0x0626 - 0x600] = 0x064A;                          // yeh with hamza
+    t[0x0649 - 0x600] = 0x064A;                          // alef maqsura
+    t[0x06CC - 0x600] = 0x064A;                          // Farsi yeh
+    t[0x0629 - 0x600] = 0x0647;                          // ta marbuta
+    t[0x06A9 - 0x600] = 0x0643;                          // keheh
+    // Tashkeel (0x064B..0x065F), superscript alef and tatweel stay 0 (dropped)
+    return t;
+}
+constexpr std::array<uint16_t, 256> kArabic = make_arabic();
+
+// Decode one UTF-8 sequence at in[i]; returns its length, 0 if malformed
+size_t decode(std::string_view in, size_t i, uint32_t& cp){
+    unsigned char c = (unsigned char)in[i];
+    size_t len; uint32_t min;
+    if (c >= 0xC2 && c <= 0xDF){ len = 2; cp = c & 0x1F; min = 0x80; }
+    else if (c >= 0xE0 && c <= 0xEF){ len = 3; cp = c & 0x0F; min = 0x800; }
+    else if (c >= 0xF0 && c <= 0xF4){ len = 4; cp = c & 0x07; min = 0x10000; }
+    else return 0;
+    if (i + len > in.size()) return 0;
+    for (size_t k = 1; k < len; ++k){
+        unsigned char cc = (unsigned char)in[i + k];
+        if ((cc & 0xC0) != 0x80) return 0;
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    return cp >= min ? len : 0;
+}
+
+} // namespace
+
+void fold_into(std::string_view in, std::string& out){
+    out.clear();
+    out.reserve(in.size());
+    auto space = [&]{ if (out.empty() || out.back() != ' ') out.push_back(' '); };
+    size_t i = 0;
+    while (i < in.size()){
+        unsigned char c = (unsigned char)in[i];
+        if (c < 0x80){
+            ++i;
+            if (c >= 'A' && c <= 'Z') out.push_back((char)(c + ('a' - 'A')));
+            else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == ',') out.push_back((char)c);
+            else if (c == ' ') space();
+            continue;
+        }
+        uint32_t cp = 0;
+        size_t len = decode(in, i, cp);
+        if (len == 0){ ++i; continue; }
+        i += len;
+        if (cp == 0xA0){ space(); continue; }
+        if (cp >= kLatinFirst && cp <= kLatinLast){ out += kLatin[cp - kLatinFirst]; continue; }
+        if (cp >= 0x0600 && cp <= 0x06FF){
+            uint16_t m = kArabic[cp - 0x600];
+            if (m == 0) continue;
+            if (m < 0x80){ out.push_back((char)m); continue; }
+            out.push_back((char)(0xC0 | (m >> 6)));
+            out.push_back((char)(0x80 | (m & 0x3F)));
+        }
+        // Combining marks and everything else: dropped
+    }
+}
+
+std::string fold(std::string_view in){
+    std::string out;
+    fold_into(in, out);
+    return out;
+}
+
+} // namespace textnorm
@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace textnorm {
+
+// Fold text for matching in one pass over UTF-8:
+// - ASCII letters lowercased; digits, ',' and single spaces kept (runs collapse)
+// - Latin letters with diacritics reduced to their base ("São" -> "sao", "ß" -> "ss")
+// - combining marks, Arabic tashkeel and tatweel removed
+// - Arabic alef forms (آ أ إ ٱ) -> ا, ؤ -> و, ئ ى ی -> ي, ة -> ه, ک -> ك,
+//   Arabic-Indic digits -> ASCII digits, the Arabic comma -> ','
+// Everything else (punctuation, symbols, other scripts, invalid bytes) is dropped.
+// The output is never longer than the input; fold_into reuses `out`'s buffer.
+void fold_into(std::string_view in, std::string& out);
+std::string fold(std::string_view in);
+
+} // namespace textnorm
@@ -0,0 +1,100 @@
+#include "trace.hpp"
+
+#if defined(ALMUSLIM_TRACE)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace trace {
+
+// steady_clock rather than RDTSC: it is a vDSO call on Linux, works the same
+// on ARM, and needs no calibration against wall time
+uint64_t now_ns(){
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct Span {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t tid;
+};
+
+static const uint64_t g_origin = now_ns();
+static constexpr size_t kCapacity = 256;
+static Span g_spans[kCapacity];
+// Set (release) once a slot's Span is written; finish() reads only ready slots
+static std::atomic<bool> g_ready[kCapacity];
+static std::atomic<size_t> g_count{0};
+static std::atomic<bool> g_enabled{false};
+static std::atomic<bool> g_finished{false};
+static std::atomic<uint32_t> g_nextTid{1};
+static std::string g_path;
+
+static uint32_t thread_id(){
+    thread_local uint32_t id = g_nextTid.fetch_add(1);
+    return id;
+}
+
+void enable(std::string path){
+    g_path = std::move(path);
+    g_enabled.store(true, std::memory_order_release);
+}
+
+bool enabled(){ return g_enabled.load(std::memory_order_relaxed); }
+
+void record(const char* name, uint64_t startNs, uint64_t endNs){
+    size_t i = g_count.fetch_add(1, std::memory_order_relaxed);
+    if (i >= kCapacity) return;
+    g_spans[i] = Span{name, startNs, endNs, thread_id()};
+    g_ready[i].store(true, std::memory_order_release);
+}
+
+void finish(){
+    if (!enabled() || g_finished.exchange(true)) return;
+    const uint64_t end = now_ns();
+    // Slots claimed by a record() still in progress on another thread are skipped
+    const size_t claimed = std::min(g_count.load(), kCapacity);
+    std::vector<Span> spans;
+    spans.reserve(claimed);
+    for (size_t i = 0; i < claimed; ++i)
+        if (g_ready[i].load(std::memory_order_acquire)) spans.push_back(g_spans[i]);
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b){ return a.start < b.start; });
+    auto us = [](uint64_t ns){ return (double)(ns - g_origin) / 1000.0; };
+
+    if (std::FILE* f = std::fopen(g_path.c_str(), "wb")){
+        std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        std::fprintf(f, "{\"name\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":0,\"dur\":%.3f}", thread_id(), us(end));
+        for (const Span& s : spans)
+            std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         s.name, s.tid, us(s.start), (double)(s.end - s.start) / 1000.0);
+        std::fprintf(f, "\n]}\n");
+        std::fclose(f);
+    } else {
+        std::fprintf(stderr, "Cannot write trace file %s\n", g_path.c_str());
+    }
+
+    // One line: total, then each span in start order (other threads marked)
+    std::string line;
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "startup %.3f ms:", us(end) / 1000.0);
+    line += buf;
+    const uint32_t self = thread_id();
+    bool offThread = false;
+    for (const Span& s : spans){
+        offThread = offThread || s.tid != self;
+        std::snprintf(buf, sizeof(buf), " %s%s %.3f", s.name, s.tid == self ? "" : "*", (double)(s.end - s.start) / 1e6);
+        line += buf;
+    }
+    if (offThread) line += " (* other thread)";
+    if (g_count.load() > kCapacity || spans.size() < claimed) line += " (some spans dropped)";
+    std::fprintf(stderr, "%s -> %s\n", line.c_str(), g_path.c_str());
+}
+
+} // namespace trace
+
+#endif
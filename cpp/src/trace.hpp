@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Startup phase tracing for --trace-startup: scoped timers around the phases
+// of a start (config, data loads, compute, render), written as a Chrome /
+// Perfetto trace file (chrome://tracing, ui.perfetto.dev) plus a one-line
+// summary on stderr. Compiled in only with ALMUSLIM_TRACE defined (cmake
+// -DALMUSLIM_TRACE=ON); otherwise the macros expand to nothing and the
+// functions are empty inlines, so release builds carry no cost.
+//
+//   ALMUSLIM_TRACE_SCOPE("cities");          // until the end of the block
+//   ALMUSLIM_TRACE_SPAN(render, "render");   // named, for sequential phases
+//   ...
+//   ALMUSLIM_TRACE_END(render);
+namespace trace {
+
+#if defined(ALMUSLIM_TRACE)
+
+constexpr bool kCompiledIn = true;
+
+// Start recording; finish() writes the trace to `path`. Times are relative to
+// static initialization of this module, i.e. close to process start.
+void enable(std::string path);
+bool enabled();
+// Monotonic nanoseconds (steady_clock)
+uint64_t now_ns();
+// Thread-safe; spans beyond a fixed capacity are dropped
+void record(const char* name, uint64_t startNs, uint64_t endNs);
+// Write the trace file and the summary; later calls do nothing
+void finish();
+
+class Scope {
+public:
+    explicit Scope(const char* name) : name_(name), start_(enabled() ? now_ns() : 0) {}
+    ~Scope(){ end(); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    void end(){ if (start_){ record(name_, start_, now_ns()); start_ = 0; } }
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+
+#define ALMUSLIM_TRACE_CAT2(a, b) a##b
+#define ALMUSLIM_TRACE_CAT(a, b) ALMUSLIM_TRACE_CAT2(a, b)
+#define ALMUSLIM_TRACE_SCOPE(name) ::trace::Scope ALMUSLIM_TRACE_CAT(traceScope_, __LINE__)(name)
+#define ALMUSLIM_TRACE_SPAN(var, name) ::trace::Scope traceSpan_##var(name)
+#define ALMUSLIM_TRACE_END(var) traceSpan_##var.end()
+
+#else
+
+constexpr bool kCompiledIn = false;
+
+inline void enable(const std::string&) {}
+inline bool enabled() { return false; }
+inline void finish() {}
+
+#define ALMUSLIM_TRACE_SCOPE(name) ((void)0)
+#define ALMUSLIM_TRACE_SPAN(var, name) ((void)0)
+#define ALMUSLIM_TRACE_END(var) ((void)0)
+
+#endif
+
+} // namespace trace
@@ -1,13 +1,16 @@
 #include "ui.hpp"
+#include "aliases.hpp"
+#include "citydb.hpp"
+#include "editdist.hpp"
+#include "platform.hpp"
+#include "textnorm.hpp"
 #include <algorithm>
 #include <cctype>
 #include <cmath>
-#include <fstream>
 #include <iostream>
 #include <sstream>
 
 using std::string;
-namespace fs = std::filesystem;
 
 static string trim(string s){
     auto l = std::find_if(s.begin(), s.end(), [](unsigned char c){return !std::isspace(c);});
@@ -16,141 +19,49 @@ static string trim(string s){
     return string(l, r);
 }
 
-std::vector<City> load_cities(const fs::path& dataDir){
-    std::vector<City> out;
-    fs::path csv = dataDir / "cities.csv";
-    std::ifstream in(csv);
-    if (!in) return out;
-    string line; bool first=true;
-    while (std::getline(in, line)){
-            // Strip UTF-8 BOM on the first line if present
-            if (first && line.size()>=3 && (unsigned char)line[0]==0xEF && (unsigned char)line[1]==0xBB && (unsigned char)line[2]==0xBF) {
-                line.erase(0,3);
-            }
-            if (first){
-                first=false; // skip header if present
-                string t = line; for(char &c: t) c = (char)std::tolower((unsigned char)c);
-                if (t.find("name")!=string::npos && t.find("lat")!=string::npos) continue;
-            }
-            string trimmed = trim(line);
-            if (trimmed.empty()) continue;
-            if (!trimmed.empty() && trimmed[0]=='#') continue; // comment line
-        std::stringstream ss(line);
-        string name,country,lat,lon,tz;
-        if (!std::getline(ss, name, ',')) continue;
-        std::getline(ss, country, ',');
-        std::getline(ss, lat, ',');
-        std::getline(ss, lon, ',');
-        std::getline(ss, tz, ',');
-        City c{};
-        c.name=trim(name); c.country=trim(country);
-        try{
-            c.lat = std::stod(trim(lat));
-            c.lon = std::stod(trim(lon));
-        }catch(...){ continue; }
-        c.tz = trim(tz);
-        out.push_back(c);
-    }
-    return out;
-}
-
-// Basic interactive selection: filter by substring, show top 10, choose by number
-std::optional<City> select_city_interactive(const std::vector<City>& cities){
-    if (cities.empty()) return std::nullopt;
-    std::vector<size_t> idx(cities.size());
-    for(size_t i=0;i<idx.size();++i) idx[i]=i;
-
-    string query;
-    while (true){
-        // filter
-        std::vector<size_t> filtered;
-        string ql = query; for(char &c: ql) c = (char)std::tolower((unsigned char)c);
-        for(size_t i: idx){
-            string s = cities[i].name + ", " + cities[i].country;
-            string sl = s; for(char &c: sl) c = (char)std::tolower((unsigned char)c);
-            if (ql.empty() || sl.find(ql)!=string::npos) filtered.push_back(i);
-        }
-        std::cout << "\nSelect your city (type to search, enter number, or q to cancel)\n";
-        std::cout << "Query: " << query << "\n";
-        size_t shown = std::min<size_t>(10, filtered.size());
-        for(size_t k=0;k<shown;++k){
-            const auto &c = cities[filtered[k]];
-            std::cout << "  [" << (k+1) << "] " << c.name << ", " << c.country
-                      << "  (" << c.lat << ", " << c.lon << ")  tz: " << c.tz << "\n";
-        }
-        if (filtered.size()>shown) std::cout << "  ... (" << (filtered.size()-shown) << " more)" << "\n";
-        std::cout << "> ";
-        std::string input; std::getline(std::cin, input);
-        if (!std::cin) return std::nullopt;
-        input = trim(input);
-        if (input=="q" || input=="quit" || input=="exit") return std::nullopt;
-        if (input.empty()) { continue; }
-        bool isnum = !input.empty() && std::all_of(input.begin(), input.end(), [](unsigned char c){return std::isdigit(c);});
-        if (isnum){
-            int choice = std::stoi(input);
-            if (choice>=1 && (size_t)choice<=shown){
-                return cities[filtered[(size_t)choice-1]];
-            } else {
-                std::cout << "Invalid number.\n";
-            }
-        } else {
-            // Update query
-            query = input;
+// The k best items pushed so far: a heap whose front is the worst kept item,
+// so each push costs O(log k). `better(a, b)` ranks a ahead of b.
+template <class T, class Better>
+class TopK {
+public:
+    TopK(size_t k, Better better) : k_(k), better_(better) { heap_.reserve(k); }
+    bool full() const { return heap_.size() == k_; }
+    const T& worst() const { return heap_.front(); }
+    bool contains(const T& v) const { return std::find(heap_.begin(), heap_.end(), v) != heap_.end(); }
+    void push(const T& v){
+        if (heap_.size() < k_){
+            heap_.push_back(v);
+            std::push_heap(heap_.begin(), heap_.end(), better_);
+        } else if (k_ > 0 && better_(v, heap_.front())){
+            std::pop_heap(heap_.begin(), heap_.end(), better_);
+            heap_.back() = v;
+            std::push_heap(heap_.begin(), heap_.end(), better_);
         }
     }
-}
+    // Best first
+    std::vector<T> take(){
+        std::sort_heap(heap_.begin(), heap_.end(), better_);
+        return std::move(heap_);
+    }
+private:
+    size_t k_;
+    Better better_;
+    std::vector<T> heap_;
+};
 
-// Normalize strings for matching: lowercase, remove punctuation, apply synonyms
-static std::string normalize_str(std::string s){
-    // lowercase
-    for(char &c: s) c = (char)std::tolower((unsigned char)c);
-    // remove accents (basic): map a few common ones
-    auto rep_all = [&](const std::string &from, const std::string &to){ size_t pos=0; while((pos = s.find(from, pos)) != std::string::npos){ s.replace(pos, from.size(), to); pos += to.size(); } };
-    rep_all("á","a"); rep_all("à","a"); rep_all("â","a"); rep_all("ã","a"); rep_all("ä","a");
-    rep_all("ç","c"); rep_all("é","e"); rep_all("è","e"); rep_all("ê","e"); rep_all("ë","e");
-    rep_all("í","i"); rep_all("ì","i"); rep_all("î","i"); rep_all("ï","i"); rep_all("ñ","n");
-    rep_all("ó","o"); rep_all("ò","o"); rep_all("ô","o"); rep_all("õ","o"); rep_all("ö","o");
-    rep_all("ú","u"); rep_all("ù","u"); rep_all("û","u"); rep_all("ü","u"); rep_all("ý","y");
-    // remove apostrophes and non-alnum (keep space, comma)
-    std::string out; out.reserve(s.size());
-    for(char c: s){ if (std::isalnum((unsigned char)c) || c==' ' || c==',') out.push_back(c); }
-    s.swap(out);
-    // collapse spaces
-    std::string out2; out2.reserve(s.size()); bool prevSpace=false; for(char c: s){ if (std::isspace((unsigned char)c)){ if(!prevSpace){ out2.push_back(' '); prevSpace=true; } } else { out2.push_back(c); prevSpace=false; } }
-    s.swap(out2);
-    // synonyms/transliterations
-    auto replace_word = [&](const std::string &from, const std::string &to){
-        size_t pos = 0; while(true){ pos = s.find(from, pos); if (pos==std::string::npos) break; bool okL = (pos==0 || s[pos-1]==' '|| s[pos-1]==','); size_t end = pos+from.size(); bool okR = (end>=s.size() || s[end]==' ' || s[end]==','); if (okL && okR){ s.replace(pos, from.size(), to); pos += to.size(); } else { pos = end; } }
-    };
-    // common transliteration variants
-    replace_word("mecca", "makkah");
-    replace_word("medina", "madinah");
-    replace_word("buraydah", "buraidah");
-    replace_word("jazan", "jizan");
+// Normalize strings for matching: Unicode fold (case, diacritics, Arabic letter
+// forms; see textnorm.hpp), then spelling aliases from data/aliases.csv
+std::string normalize_str(std::string_view in){
+    std::string s = textnorm::fold(in);
+    if (auto dict = aliases::current()) dict->rewrite(s);
     return s;
 }
 
-// Levenshtein distance for fuzzy matching
-static int lev_distance(const std::string &a, const std::string &b){
-    size_t n=a.size(), m=b.size();
-    if (n==0) return (int)m; if (m==0) return (int)n;
-    std::vector<int> prev(m+1), curr(m+1);
-    for(size_t j=0;j<=m;++j) prev[j] = (int)j;
-    for(size_t i=1;i<=n;++i){
-        curr[0] = (int)i;
-        for(size_t j=1;j<=m;++j){
-            int cost = (a[i-1]==b[j-1])?0:1;
-            curr[j] = std::min({ prev[j] + 1, curr[j-1] + 1, prev[j-1] + cost });
-        }
-        std::swap(prev, curr);
-    }
-    return prev[m];
-}
-
 // Compute a composite score: substring proximity + fuzzy match (lower is better distance)
-static int score_match(const std::string& hay_raw, const std::string& needle_raw){
-    std::string hay = normalize_str(hay_raw);
-    std::string needle = normalize_str(needle_raw);
+// Both arguments are already normalized. Callers that only care about scores above
+// `beat` pass it so the edit distance can stop early; the result is exact whenever
+// it exceeds `beat`.
+static int score_normalized(std::string_view hay, std::string_view needle, int beat = -1000000){
     if (needle.empty()) return -1000000;
     int score = -1000000;
     auto pos = hay.find(needle);
@@ -160,46 +71,186 @@ static int score_match(const std::string& hay_raw, const std::string& needle_raw
         score = std::max(score, proximity + length_bias);
     }
     // fuzzy against city token only as well as full "name, country"
-    int d1 = lev_distance(hay, needle);
-    int fuzzy = 300 - d1 * 20 - (int)std::abs((int)hay.size() - (int)needle.size());
+    int lenDiff = (int)std::abs((int)hay.size() - (int)needle.size());
+    int room = 300 - lenDiff - std::max(beat, score); // fuzzy must exceed this floor
+    if (room <= 0) return score;
+    int d1 = editdist::levenshtein_bounded(hay, needle, (room - 1) / 20);
+    int fuzzy = 300 - d1 * 20 - lenDiff;
     score = std::max(score, fuzzy);
     return score;
 }
 
-std::optional<City> find_best_city_match(const std::vector<City>& cities, const std::string& query){
-    if (cities.empty()) return std::nullopt;
-    if (query.empty()) return std::nullopt;
-    std::string q = query;
-    // First try exact normalized match on city or "city, country"
-    std::string qn = normalize_str(q);
-    for (const auto &c : cities){
-        std::string n1 = normalize_str(c.name);
-        std::string n2 = normalize_str(c.name + ", " + c.country);
-        if (qn == n1 || qn == n2) return c;
+std::vector<CityMatch> search_cities(const citydb::Index& db, const std::string& query, size_t k){
+    if (db.empty() || query.empty() || k == 0) return {};
+    std::string qn = normalize_str(query);
+    // Only cities sharing trigrams with the query are considered; the best few
+    // hundred by shared trigrams get the edit-distance score.
+    std::vector<uint32_t> cand = db.trigram_candidates(qn, std::max<size_t>(256, k));
+    if (cand.empty()){
+        // Query too short or nothing in common: fall back to a full scan
+        cand.resize(db.size());
+        for (size_t i=0;i<db.size();++i) cand[i] = (uint32_t)i;
     }
-    int bestScore = -1000000; size_t bestIdx = 0;
-    for(size_t i=0;i<cities.size();++i){
-        std::string s = cities[i].name + ", " + cities[i].country;
-        int sc = score_match(s, q);
-        if (sc > bestScore){ bestScore = sc; bestIdx = i; }
+    auto better = [&](const CityMatch& a, const CityMatch& b){
+        if (a.score != b.score) return a.score > b.score;
+        if (db.population(a.city) != db.population(b.city)) return db.population(a.city) > db.population(b.city);
+        return a.city < b.city;
+    };
+    TopK<CityMatch, decltype(better)> top(k, better);
+    for (uint32_t i : cand){
+        if (db.norm_name(i) == qn || db.norm_full(i) == qn || db.norm_ar(i) == qn){
+            top.push(CityMatch{i, kExactMatch});
+            continue;
+        }
+        // Scores below the current k-th best can stop early; ties stay exact
+        // so the population tie-break sees them
+        int beat = top.full() ? top.worst().score - 1 : -1;
+        int sc = score_normalized(db.norm_full(i), qn, beat);
+        if (!db.norm_ar(i).empty()) sc = std::max(sc, score_normalized(db.norm_ar(i), qn, std::max(sc, beat)));
+        if (sc >= 0) top.push(CityMatch{i, sc});
     }
-    if (bestScore < 0) return std::nullopt;
-    return cities[bestIdx];
+    return top.take();
+}
+
+void print_other_matches(const citydb::Index& db, const std::vector<CityMatch>& hits){
+    if (hits.size() < 2 || hits[0].score == kExactMatch) return;
+    std::cout << "Other matches:";
+    for (size_t k=1;k<hits.size();++k) std::cout << (k > 1 ? ";" : "") << " " << db.name(hits[k].city) << ", " << db.country(hits[k].city);
+    std::cout << "\n";
 }
 
-std::optional<City> prompt_city_free_text(const std::vector<City>& cities){
-    if (cities.empty()) return std::nullopt;
+std::optional<citydb::CityRef> find_city_ref(const citydb::Index& db, const std::string& query){
+    std::vector<CityMatch> m = search_cities(db, query, 1);
+    if (m.empty()) return std::nullopt;
+    return db.ref(m[0].city);
+}
+
+std::optional<City> find_best_city_match(const citydb::Index& db, const std::string& query){
+    auto r = find_city_ref(db, query);
+    if (!r) return std::nullopt;
+    return r->city();
+}
+
+// Live suggestions over the index's sorted word-start keys. Each keystroke
+// narrows the previous keystroke's range by binary search inside it; backspace
+// returns to the range saved for the shorter text.
+static std::optional<City> typeahead_city(const citydb::Index& db, platform::RawTerminal& term){
+    struct Step { size_t typedLen; std::string norm; size_t lo, hi; };
+    std::vector<Step> steps{ Step{0, std::string(), 0, db.prefix_count()} };
+    std::string typed;
+    std::vector<uint32_t> shown;
+    size_t sel = 0;
+    int drawn = 0;
+    const size_t maxShown = 8;
+
+    std::cout << "\nType your city; Up/Down to choose, Enter to accept, Esc to cancel.\n";
+    while (true){
+        // The most populous distinct cities of the current range (then file
+        // order); without a prefix match, the ranked fuzzy matches instead
+        const Step& cur = steps.back();
+        shown.clear();
+        bool more = false;
+        if (!typed.empty() && cur.lo < cur.hi){
+            auto better = [&](uint32_t a, uint32_t b){
+                if (db.population(a) != db.population(b)) return db.population(a) > db.population(b);
+                return a < b;
+            };
+            // One extra slot tells whether there are more than maxShown
+            TopK<uint32_t, decltype(better)> top(maxShown + 1, better);
+            for (size_t k=cur.lo; k<cur.hi; ++k){
+                uint32_t id = db.prefix_city(k);
+                if (!top.contains(id)) top.push(id);
+            }
+            shown = top.take();
+            if (shown.size() > maxShown){ more = true; shown.pop_back(); }
+        } else if (!typed.empty()){
+            for (const CityMatch& m : search_cities(db, typed, maxShown)) shown.push_back(m.city);
+        }
+        if (sel >= shown.size()) sel = shown.empty() ? 0 : shown.size() - 1;
+
+        std::ostringstream out;
+        if (drawn > 0) out << "\x1b[" << drawn << "F"; else out << "\r";
+        out << "\x1b[J";
+        drawn = 0;
+        if (typed.empty()){
+            // nothing typed yet: keep the prompt line only
+        } else if (shown.empty()){
+            out << "  (no match; Enter picks the closest spelling)\n"; ++drawn;
+        } else {
+            for (size_t k=0;k<shown.size();++k){
+                out << (k == sel ? "> " : "  ") << db.name(shown[k]) << ", " << db.country(shown[k]);
+                if (!db.name_ar(shown[k]).empty()) out << "  " << db.name_ar(shown[k]);
+                out << "\n"; ++drawn;
+            }
+            if (more){ out << "  ...\n"; ++drawn; }
+        }
+        out << "> " << typed;
+        std::cout << out.str() << std::flush;
+
+        int key = term.read_key();
+        if (key == platform::KeyEof || key == platform::KeyEscape){
+            std::cout << "\n";
+            return std::nullopt;
+        }
+        if (key == platform::KeyEnter){
+            std::cout << "\n";
+            if (!shown.empty()) return db.city(shown[sel]);
+            std::string t = trim(typed);
+            if (t.empty()) return std::nullopt;
+            auto m = find_best_city_match(db, t);
+            if (!m) std::cout << "Could not find a close match for '" << t << "'.\n";
+            return m;
+        }
+        if (key == platform::KeyUp){ if (sel > 0) --sel; continue; }
+        if (key == platform::KeyDown){ if (sel + 1 < shown.size()) ++sel; continue; }
+        if (key == platform::KeyBackspace){
+            if (typed.empty()) continue;
+            // Drop one UTF-8 character (continuation bytes are 10xxxxxx)
+            while (!typed.empty() && ((unsigned char)typed.back() & 0xC0) == 0x80) typed.pop_back();
+            if (!typed.empty()) typed.pop_back();
+            while (steps.size() > 1 && steps.back().typedLen > typed.size()) steps.pop_back();
+            sel = 0;
+            continue;
+        }
+        if (key < 32 || key > 255) continue;
+        typed.push_back((char)key);
+        std::string qn = normalize_str(typed);
+        size_t lead = qn.find_first_not_of(' ');
+        qn.erase(0, lead == std::string::npos ? qn.size() : lead);
+        const Step& prev = steps.back();
+        // Extending the previous text only ever narrows its range; synonym
+        // rewrites (e.g. "mecca") can change earlier bytes, so search everything then.
+        std::pair<size_t, size_t> r = qn.compare(0, prev.norm.size(), prev.norm) == 0
+            ? db.prefix_range(qn, prev.lo, prev.hi)
+            : db.prefix_range(qn, 0, db.prefix_count());
+        steps.push_back(Step{typed.size(), qn, r.first, r.second});
+        sel = 0;
+    }
+}
+
+std::optional<City> prompt_city_free_text(const citydb::Index& db){
+    if (db.empty()) return std::nullopt;
+    {
+        platform::RawTerminal term;
+        if (term.active()){
+            auto m = typeahead_city(db, term);
+            if (m) std::cout << "Using: " << m->name << ", " << m->country
+                             << "  (" << m->lat << ", " << m->lon << ") tz: " << m->tz << "\n";
+            return m;
+        }
+    }
     std::cout << "\nType your city (e.g., Riyadh or Riyadh, Saudi Arabia). Type 'q' to cancel.\n> ";
     std::string input; if (!std::getline(std::cin, input)) return std::nullopt;
     std::string t = trim(input);
     if (t == "" || t == "q" || t == "quit" || t == "exit") return std::nullopt;
-    auto m = find_best_city_match(cities, t);
-    if (!m){
+    std::vector<CityMatch> hits = search_cities(db, t, 4);
+    if (hits.empty()){
         std::cout << "Could not find a close match for '" << t << "'.\n";
         return std::nullopt;
     }
-    const City &c = *m;
+    City c = db.city(hits[0].city);
     std::cout << "Using: " << c.name << ", " << c.country
               << "  (" << c.lat << ", " << c.lon << ") tz: " << c.tz << "\n";
-    return m;
+    print_other_matches(db, hits);
+    return c;
 }
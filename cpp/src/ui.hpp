@@ -1,9 +1,12 @@
 #pragma once
-#include <filesystem>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+namespace citydb { class Index; class CityRef; }
+
 struct City {
     std::string name;
     std::string country;
@@ -11,18 +14,30 @@ struct City {
     double lon = 0.0;
     // Either numeric offset like "+3" or with minutes "+03:30" or a short label like "UTC"
     std::string tz;
+    std::string nameAr;   // Arabic name (optional name_ar column)
+    uint32_t population = 0;  // optional population column; ranks otherwise equal matches
 };
 
-// Load cities from data/cities.csv under the given data directory
-std::vector<City> load_cities(const std::filesystem::path& dataDir);
+// City lookup against the index's precomputed normalized names.
+// find_city_ref returns a handle into the index; find_best_city_match copies
+// the entry out.
+std::optional<citydb::CityRef> find_city_ref(const citydb::Index& db, const std::string& query);
 
-// Simple interactive selector using standard input/output (works in basic terminals)
-// Returns std::nullopt if user cancels.
-std::optional<City> select_city_interactive(const std::vector<City>& cities);
+// A ranked search result: city id in the index and its match score
+// (higher is better; exact name matches score kExactMatch)
+struct CityMatch { uint32_t city; int score; };
+constexpr int kExactMatch = 1000;
 
-// Find best city match for a free-text query (e.g., "Riyadh" or "Riyadh, Saudi Arabia").
-// Returns the best guess without prompting for numbers.
-std::optional<City> find_best_city_match(const std::vector<City>& cities, const std::string& query);
+// Up to k matches for a free-text query, best first; equal scores rank the
+// larger population first, then file order. Keeps a k-sized heap while
+// scoring, so the cost is O(candidates * log k). find_city_ref is the k = 1 case.
+std::vector<CityMatch> search_cities(const citydb::Index& db, const std::string& query, size_t k);
+// "Other matches: ..." line for hits[1..] after hits[0] was picked; nothing
+// when hits[0] matched exactly
+void print_other_matches(const citydb::Index& db, const std::vector<CityMatch>& hits);
+std::optional<City> find_best_city_match(const citydb::Index& db, const std::string& query);
+std::optional<City> prompt_city_free_text(const citydb::Index& db);
 
-// Prompt once for a free-text city and return the best match; allows typing only (no numeric list).
-std::optional<City> prompt_city_free_text(const std::vector<City>& cities);
+// Normalize strings for matching: case fold, strip diacritics (Latin and Arabic)
+// and punctuation, unify Arabic letter variants, apply synonyms
+std::string normalize_str(std::string_view s);
@@ -0,0 +1,124 @@
+#include "zoneclock.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+
+namespace zoneclock {
+
+// Re-anchor at least this often so NTP steps or manual clock changes show up
+static const long kMaxSegmentSec = 15 * 60;
+
+static std::tm to_local(time_t t){
+    std::tm lt{};
+#if defined(_WIN32)
+    localtime_s(&lt, &t);
+#else
+    localtime_r(&t, &lt);
+#endif
+    return lt;
+}
+
+// Interpret a broken-down time as UTC
+static time_t utc_timegm(std::tm tm){
+#if defined(_WIN32)
+    return _mkgmtime(&tm);
+#else
+    return timegm(&tm);
+#endif
+}
+
+static long offset_at(time_t t){
+    return (long)(utc_timegm(to_local(t)) - t);
+}
+
+void ZoneClock::refresh(){
+    using namespace std::chrono;
+    steadyBase_ = steady_clock::now();
+    auto sys = system_clock::now();
+    epochBase_ = duration<double>(sys.time_since_epoch()).count();
+    time_t t = system_clock::to_time_t(sys);
+
+    std::tm lt = to_local(t);
+    offsetSec_ = (long)(utc_timegm(lt) - t);
+    today_ = lt; today_.tm_hour = 0; today_.tm_min = 0; today_.tm_sec = 0;
+    dayStartLocal_ = (double)utc_timegm(today_);
+
+    // Segment ends at local midnight, or earlier if the offset changes before then
+    time_t end = (time_t)dayStartLocal_ + 86400 - offsetSec_;
+    if (offset_at(end) != offsetSec_){
+        time_t lo = t, hi = end; // offset(lo) == offsetSec_, offset(hi) differs
+        while (hi - lo > 1){
+            time_t mid = lo + (hi - lo) / 2;
+            if (offset_at(mid) == offsetSec_) lo = mid; else hi = mid;
+        }
+        end = hi;
+    }
+    if (end - t > kMaxSegmentSec) end = t + kMaxSegmentSec;
+    validUntil_ = (double)end;
+    valid_ = true;
+}
+
+double ZoneClock::now_epoch(){
+    using namespace std::chrono;
+    if (valid_){
+        double now = epochBase_ + duration<double>(steady_clock::now() - steadyBase_).count();
+        if (now < validUntil_) return now;
+    }
+    refresh();
+    return epochBase_;
+}
+
+double ZoneClock::seconds_since_midnight(){
+    double now = now_epoch();
+    return now + (double)offsetSec_ - dayStartLocal_;
+}
+
+double ZoneClock::utc_offset_hours(){
+    now_epoch();
+    return offsetSec_ / 3600.0;
+}
+
+std::tm ZoneClock::local_now(){
+    long s = (long)seconds_since_midnight();
+    std::tm lt = today_;
+    lt.tm_hour = (int)(s / 3600); lt.tm_min = (int)(s / 60 % 60); lt.tm_sec = (int)(s % 60);
+    return lt;
+}
+
+ZoneClock& ui_clock(){
+    static ZoneClock c;
+    return c;
+}
+
+#if defined(_WIN32)
+std::optional<double> zone_offset_hours(const std::string&, time_t){
+    return std::nullopt;
+}
+#else
+// A zone name names a file under the zoneinfo directory; the C library falls
+// back to UTC for unknown names, so check that the file exists first
+static bool zone_known(const std::string& name){
+    if (name.empty() || name.front() == '/' || name.find("..") != std::string::npos) return false;
+    const char* env = std::getenv("TZDIR");
+    const char* dirs[] = { env && *env ? env : "/usr/share/zoneinfo", "/usr/lib/zoneinfo", "/usr/share/lib/zoneinfo" };
+    for (const char* d : dirs){
+        std::error_code ec;
+        if (std::filesystem::is_regular_file(std::filesystem::path(d) / name, ec)) return true;
+    }
+    return false;
+}
+
+std::optional<double> zone_offset_hours(const std::string& name, time_t t){
+    if (!zone_known(name)) return std::nullopt;
+    const char* old = std::getenv("TZ");
+    std::string saved = old ? old : "";
+    setenv("TZ", (":" + name).c_str(), 1);
+    tzset();
+    long off = offset_at(t);
+    if (old) setenv("TZ", saved.c_str(), 1); else unsetenv("TZ");
+    tzset();
+    return off / 3600.0;
+}
+#endif
+
+} // namespace zoneclock
@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <ctime>
+#include <optional>
+#include <string>
+
+namespace zoneclock {
+
+// Local wall clock for long-running views (live countdown, REPL redraws).
+// The UTC offset, today's date and the local-midnight anchor are computed once
+// and reused until the next local midnight, the next UTC-offset change (DST),
+// or a periodic re-anchor that picks up wall-clock steps. In between, every
+// query is a single steady_clock read. Not thread-safe: one instance per thread.
+class ZoneClock {
+public:
+    // Seconds since local midnight (wall clock, fractional)
+    double seconds_since_midnight();
+    double hours_since_midnight() { return seconds_since_midnight() / 3600.0; }
+
+    // UTC offset in effect now, in hours east of UTC
+    double utc_offset_hours();
+
+    // Broken-down local time (date fields cached; h/m/s from the monotonic clock)
+    std::tm local_now();
+
+    // Drop the cache, e.g. after the TZ environment changed
+    void invalidate() { valid_ = false; }
+
+private:
+    void refresh();
+    double now_epoch(); // current UTC epoch seconds; refreshes the cache if it expired
+
+    bool valid_ = false;
+    std::chrono::steady_clock::time_point steadyBase_{};
+    double epochBase_ = 0.0;   // system time (UTC seconds) at steadyBase_
+    double validUntil_ = 0.0;  // UTC epoch seconds at which the cache expires
+    long offsetSec_ = 0;       // UTC offset for the cached segment
+    double dayStartLocal_ = 0; // local midnight expressed as "local epoch" seconds
+    std::tm today_{};          // local date (time fields zeroed)
+};
+
+// Process-wide instance for the UI thread
+ZoneClock& ui_clock();
+
+// UTC offset in hours of the IANA zone `name` ("Europe/London") at `t`, from the
+// system zoneinfo database; std::nullopt if the zone is not in it or there is no
+// database (Windows). Switches TZ for the lookup and restores it, so call it
+// from the UI thread only; ZoneClock caches are not affected.
+std::optional<double> zone_offset_hours(const std::string& name, time_t t);
+
+} // namespace zoneclock
@@ -0,0 +1,28 @@
+// Build-time city index compiler: writes cities.idx for the data directory so
+// that the build can embed it next to cities.csv (see CMakeLists.txt). Same
+// output as `al-muslim build-index`, without needing the full program.
+// Usage: al-muslim-index --data <dir> --out <file>
+#include "citydb.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    std::filesystem::path dataDir, out;
+    for (int i = 1; i + 1 < argc; i += 2){
+        std::string a = argv[i];
+        if (a == "--data") dataDir = argv[i + 1];
+        else if (a == "--out") out = argv[i + 1];
+    }
+    if (dataDir.empty() || out.empty()){
+        std::fprintf(stderr, "Usage: al-muslim-index --data <dir> --out <file>\n");
+        return 2;
+    }
+    std::string err;
+    std::vector<citydb::CsvError> bad;
+    long n = citydb::build_index_file(dataDir, out, &err, &bad);
+    for (const auto& e : bad) std::fprintf(stderr, "%s:%zu: %s\n", (dataDir / "cities.csv").string().c_str(), e.line, e.message.c_str());
+    if (n < 0){ std::fprintf(stderr, "build-index failed: %s\n", err.c_str()); return 1; }
+    return 0;
+}